@@ -0,0 +1,248 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+/**
+ * Host benchmark of the configuration storage formats used by ConfigFS:
+ * size, save and load time and peak heap of the pretty printed JSON file
+ * (EWC_CONFIG_JSON, previous format) and the MessagePack file (default).
+ * Load is measured as done by ConfigFS::setup(): one filtered parse per module.
+ *
+ * Build and run with the header only ArduinoJson 7 (https://github.com/bblanchon/ArduinoJson):
+ *
+ *     g++ -O2 -std=c++11 -I<ArduinoJson>/src bench/config_store.cpp -o config_store && ./config_store
+ *
+ * The times of the host only compare the formats, the ESP is slower by a constant factor.
+ */
+
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/** Allocator which tracks the current and the peak heap of the documents. **/
+class TrackingAllocator : public ArduinoJson::Allocator
+{
+public:
+  void *allocate(size_t size) override
+  {
+    size_t *block = static_cast<size_t *>(malloc(size + sizeof(size_t)));
+    if (block == nullptr)
+    {
+      return nullptr;
+    }
+    *block = size;
+    _add(size);
+    return block + 1;
+  }
+
+  void deallocate(void *ptr) override
+  {
+    if (ptr == nullptr)
+    {
+      return;
+    }
+    size_t *block = static_cast<size_t *>(ptr) - 1;
+    used -= *block;
+    free(block);
+  }
+
+  void *reallocate(void *ptr, size_t newSize) override
+  {
+    if (ptr == nullptr)
+    {
+      return allocate(newSize);
+    }
+    size_t *block = static_cast<size_t *>(ptr) - 1;
+    size_t oldSize = *block;
+    block = static_cast<size_t *>(realloc(block, newSize + sizeof(size_t)));
+    if (block == nullptr)
+    {
+      return nullptr;
+    }
+    *block = newSize;
+    used -= oldSize;
+    _add(newSize);
+    return block + 1;
+  }
+
+  void reset()
+  {
+    used = 0;
+    peak = 0;
+  }
+
+  size_t used = 0;
+  size_t peak = 0;
+
+private:
+  void _add(size_t size)
+  {
+    used += size;
+    if (used > peak)
+    {
+      peak = used;
+    }
+  }
+};
+
+static const char *MODULES[] = {"ewc", "time", "mqtt", "mail"};
+static const int ITERATIONS = 2000;
+
+/** Document with the keys written by the fillJson() of Config, Time, Mqtt and Mail. **/
+static void fillConfig(JsonDocument &doc)
+{
+  JsonObject ewc = doc["ewc"].to<JsonObject>();
+  ewc["wifi_disabled"] = false;
+  ewc["dev_name"] = "ewc-1A2B3C";
+  ewc["enable_serial_log_disabled"] = false;
+  ewc["apName"] = "ewc-1A2B3C";
+  ewc["apPass"] = "ap-passphrase";
+  ewc["ap_start_always"] = false;
+  ewc["basic_auth"] = true;
+  ewc["httpUser"] = "admin";
+  ewc["httpPass"] = "http-password";
+  ewc["hostname"] = "ewc-1A2B3C";
+  ewc["enable_serial_log"] = true;
+  ewc["sta_ip"] = "192.168.1.50";
+  ewc["sta_gw"] = "192.168.1.1";
+  ewc["sta_sn"] = "255.255.255.0";
+  ewc["sta_dns1"] = "192.168.1.1";
+  ewc["sta_dns2"] = "";
+  JsonArray networks = ewc["networks"].to<JsonArray>();
+  for (int i = 0; i < 5; i++)
+  {
+    JsonObject network = networks.add<JsonObject>();
+    network["ssid"] = std::string("network-") + std::to_string(i);
+    network["pass"] = std::string("passphrase-of-network-") + std::to_string(i);
+  }
+  JsonObject time = doc["time"].to<JsonObject>();
+  time["timezone"] = 31;
+  time["ntp_enabled"] = true;
+  time["manually"] = false;
+  time["mdate"] = "2024-01-01";
+  time["mtime"] = "12:00";
+  time["dnd_enabled"] = false;
+  time["dnd_from"] = "22:00";
+  time["dnd_to"] = "06:00";
+  time["current"] = "2024-01-01 12:00:00";
+  JsonObject mqtt = doc["mqtt"].to<JsonObject>();
+  mqtt["enabled"] = true;
+  mqtt["server"] = "mqtt.local";
+  mqtt["port"] = 1883;
+  mqtt["user"] = "device";
+  mqtt["pass"] = "mqtt-password";
+  mqtt["prefix"] = "ewc";
+  mqtt["send_interval"] = 60;
+  JsonObject mail = doc["mail"].to<JsonObject>();
+  mail["on_warning"] = true;
+  mail["on_change"] = true;
+  mail["on_event"] = false;
+  mail["smtp"] = "smtp.example.com";
+  mail["port"] = 587;
+  mail["sender"] = "device@example.com";
+  mail["passphrase"] = "mail-password";
+  mail["receiver"] = "owner@example.com";
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+}
+
+/** Serializes the document like ConfigFS::_write(). **/
+static std::string save(const JsonDocument &doc, bool json)
+{
+  std::string out;
+  if (json)
+  {
+    serializeJsonPretty(doc, out);
+  }
+  else
+  {
+    serializeMsgPack(doc, out);
+  }
+  return out;
+}
+
+/** Parses the file once per module with a filter like ConfigFS::setup(). Returns false on error. **/
+static bool load(const std::string &file, bool json, TrackingAllocator &allocator)
+{
+  for (const char *module : MODULES)
+  {
+    JsonDocument filter;
+    filter[module] = true;
+    JsonDocument doc(&allocator);
+    DeserializationError error = json ? deserializeJson(doc, file, DeserializationOption::Filter(filter))
+                                      : deserializeMsgPack(doc, file, DeserializationOption::Filter(filter));
+    if (error || doc[module].isNull())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool bench(const char *name, bool json)
+{
+  JsonDocument config;
+  fillConfig(config);
+
+  TrackingAllocator saveAllocator;
+  JsonDocument saveDoc(&saveAllocator);
+  fillConfig(saveDoc);
+  std::string file = save(saveDoc, json);
+  size_t savePeak = saveAllocator.peak;
+
+  auto start = std::chrono::steady_clock::now();
+  size_t bytes = 0;
+  for (int i = 0; i < ITERATIONS; i++)
+  {
+    bytes += save(config, json).size();
+  }
+  double saveUs = elapsedUs(start);
+
+  TrackingAllocator loadAllocator;
+  if (!load(file, json, loadAllocator))
+  {
+    printf("%s: load failed\n", name);
+    return false;
+  }
+  size_t loadPeak = loadAllocator.peak;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ITERATIONS; i++)
+  {
+    load(file, json, loadAllocator);
+  }
+  double loadUs = elapsedUs(start);
+
+  printf("%-8s %6zu bytes  save %8.2f us  load %8.2f us  peak heap: document %6zu bytes, module load %6zu bytes\n",
+         name, file.size(), saveUs, loadUs, savePeak, loadPeak);
+  return bytes > 0;
+}
+
+int main()
+{
+  printf("%d iterations, load parses the file once per module (%zu modules)\n", ITERATIONS, sizeof(MODULES) / sizeof(MODULES[0]));
+  bool ok = bench("JSON", true);
+  ok = bench("MsgPack", false) && ok;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
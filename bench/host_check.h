@@ -0,0 +1,66 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_HOST_CHECK_H
+#define EWC_HOST_CHECK_H
+
+/**
+ * Minimal check macros of the host tests in this folder. A failed check prints the
+ * location and the expression and continues, hostCheckResult() is the exit code of main().
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+static int hostCheckCount = 0;
+static int hostCheckFailed = 0;
+
+#define CHECK(expr)                                                           \
+  do                                                                          \
+  {                                                                           \
+    hostCheckCount++;                                                         \
+    if (!(expr))                                                              \
+    {                                                                         \
+      hostCheckFailed++;                                                      \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr);         \
+    }                                                                         \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                                                                \
+  do                                                                                                              \
+  {                                                                                                               \
+    hostCheckCount++;                                                                                             \
+    long long a = (long long)(actual);                                                                            \
+    long long e = (long long)(expected);                                                                          \
+    if (a != e)                                                                                                   \
+    {                                                                                                             \
+      hostCheckFailed++;                                                                                          \
+      printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #actual, #expected, a, e);     \
+    }                                                                                                             \
+  } while (0)
+
+/** Prints the summary, returns the exit code. **/
+static int hostCheckResult(const char *name)
+{
+  printf("%s: %d checks, %d failed\n", name, hostCheckCount, hostCheckFailed);
+  return hostCheckFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
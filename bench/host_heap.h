@@ -0,0 +1,75 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_HOST_HEAP_H
+#define EWC_HOST_HEAP_H
+
+/**
+ * Counts the heap used through new and delete, e.g. by String. Include in one translation
+ * unit of a host test only, it replaces the global operators.
+ * heapMark() starts a measurement, heapPeak() returns the high-water mark above the start.
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+static size_t heapCurrent = 0;
+static size_t heapHighWater = 0;
+static size_t heapStart = 0;
+
+static void heapMark()
+{
+  heapStart = heapCurrent;
+  heapHighWater = heapCurrent;
+}
+
+static size_t heapPeak() { return heapHighWater - heapStart; }
+
+void *operator new(size_t size)
+{
+  // the size is stored in front of the block
+  size_t *block = static_cast<size_t *>(malloc(size + sizeof(max_align_t)));
+  if (block == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  *block = size;
+  heapCurrent += size;
+  heapHighWater = heapCurrent > heapHighWater ? heapCurrent : heapHighWater;
+  return reinterpret_cast<char *>(block) + sizeof(max_align_t);
+}
+
+void operator delete(void *ptr) noexcept
+{
+  if (ptr != nullptr)
+  {
+    size_t *block = reinterpret_cast<size_t *>(static_cast<char *>(ptr) - sizeof(max_align_t));
+    heapCurrent -= *block;
+    free(block);
+  }
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { operator delete(ptr); }
+
+#endif
@@ -0,0 +1,181 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+/**
+ * Heap high-water of the JSON responses per endpoint: ResponseWriter as used by ConfigServer::sendJson()
+ * compared with the String output the handlers serialized into before.
+ * The payloads are the sample documents in web/ used for the development of the pages, compact as
+ * sent by serializeJson(), and two larger scan results. They are written in pieces of up to 8 bytes
+ * like the tokens written by ArduinoJson.
+ * The heap of ResponseWriter is counted, the String is modeled: serializeJson() appends to a String
+ * in steps of 32 bytes, WString::changeBuffer() of the ESP8266 core 3.x reallocates to the length
+ * rounded up to 16 bytes. The peak assumes that realloc() has to move the block. The heap of the
+ * JsonDocument is the same before and after and not part of the comparison.
+ *
+ * Run from the root of the repository:
+ *
+ *     g++ -std=c++11 -Wall -DESP8266 -Ibench/stubs -Isrc bench/json_responses.cpp src/ewcResponseWriter.cpp -o json_responses && ./json_responses
+ */
+
+#include "ewcResponseWriter.h"
+#include "host_check.h"
+#include "host_heap.h"
+
+using namespace EWC;
+
+HardwareSerial Serial;
+EspClass ESP;
+unsigned long hostMillis = 0;
+
+/** Growth of the String output before. **/
+struct StringModel
+{
+  size_t len = 0;
+  size_t capacity = 0;
+  size_t reallocs = 0;
+  size_t peak = 0;
+
+  void concat(size_t size)
+  {
+    size_t needed = len + size;
+    // the small string buffer of the ESP8266 core holds 11 characters
+    if (needed > capacity && needed >= 11)
+    {
+      size_t newCapacity = (needed + 16) & ~(size_t)0xF;
+      peak = capacity + newCapacity > peak ? capacity + newCapacity : peak;
+      capacity = newCapacity;
+      reallocs++;
+    }
+    len = needed;
+  }
+};
+
+/** Reads the file and removes the whitespace outside of strings. **/
+static std::string compact(const char *path)
+{
+  std::string result;
+  FILE *file = fopen(path, "r");
+  if (file == nullptr)
+  {
+    return result;
+  }
+  bool inString = false;
+  bool escaped = false;
+  int c;
+  while ((c = fgetc(file)) != EOF)
+  {
+    if (!inString && (c == ' ' || c == '\n' || c == '\r' || c == '\t'))
+    {
+      continue;
+    }
+    if (inString && !escaped && c == '"')
+    {
+      inString = false;
+    }
+    else if (!inString && c == '"')
+    {
+      inString = true;
+    }
+    escaped = inString && !escaped && c == '\\';
+    result.push_back((char)c);
+  }
+  fclose(file);
+  return result;
+}
+
+/** Scan result with count networks in the format of /wifi/stations.json. **/
+static std::string stations(int count)
+{
+  std::string result = "{\"stations\":[";
+  char network[160];
+  for (int i = 0; i < count; i++)
+  {
+    snprintf(network, sizeof(network), "%s{\"ssid\":\"network-%02d\",\"bssid\":\"A4:2B:B0:%02X:%02X:1C\",\"rssi\":%d,\"encryption\":\"WPA2\",\"channel\":%d}", i == 0 ? "" : ",", i, i, 255 - i, -40 - i * 2, 1 + i % 13);
+    result += network;
+  }
+  return result + "]}";
+}
+
+int main()
+{
+  const char *samples[] = {"web/access/config.json", "web/ewc/info.json", "web/ewc/update.json", "web/logging/config.json", "web/mail/config.json", "web/mail/state.json", "web/menu.json", "web/mqtt/config.json", "web/mqtt/state.json", "web/time/config.json", "web/wifi/state.json", "web/wifi/stations.json", "stations x20", "stations x50"};
+  const String contentType("application/json");
+  printf("endpoint                  bytes | before: String  reallocs  peak | after: heap  sendContent\n");
+  for (const char *sample : samples)
+  {
+    std::string payload;
+    if (strcmp(sample, "stations x20") == 0)
+    {
+      payload = stations(20);
+    }
+    else if (strcmp(sample, "stations x50") == 0)
+    {
+      payload = stations(50);
+    }
+    else
+    {
+      payload = compact(sample);
+    }
+    CHECK(!payload.empty());
+    if (payload.empty())
+    {
+      printf("can not read %s, run from the root of the repository\n", sample);
+      continue;
+    }
+
+    StringModel before;
+    for (size_t pos = 0; pos < payload.size(); pos += 32)
+    {
+      before.concat(payload.size() - pos < 32 ? payload.size() - pos : 32);
+    }
+
+    ESP8266WebServer server;
+    heapMark();
+    {
+      ResponseWriter writer(&server);
+      writer.begin(200, contentType, payload.size());
+      for (size_t pos = 0; pos < payload.size(); pos += 8)
+      {
+        writer.write(reinterpret_cast<const uint8_t *>(payload.data()) + pos, payload.size() - pos < 8 ? payload.size() - pos : 8);
+      }
+      writer.end();
+    }
+    size_t after = heapPeak();
+    CHECK_EQ(after, 0);
+    CHECK_EQ(server.contentLength, payload.size());
+    CHECK_EQ(server.client().received, payload.size());
+    CHECK_EQ(server.chunks, (payload.size() + EWC_RESPONSE_BUFFER_SIZE - 1) / EWC_RESPONSE_BUFFER_SIZE);
+    printf("%-24s %6u | %14u  %8u  %4u | %11u  %11u\n", sample, (uint32_t)payload.size(), (uint32_t)before.capacity, (uint32_t)before.reallocs, (uint32_t)before.peak, (uint32_t)after, (uint32_t)server.chunks);
+  }
+
+  // without content length the response is chunked and terminated by end()
+  ESP8266WebServer server;
+  {
+    ResponseWriter writer(&server);
+    writer.begin(200, contentType);
+    writer.print("{\"a\":1}");
+  }
+  CHECK_EQ(server.contentLength, CONTENT_LENGTH_UNKNOWN);
+  CHECK(server.terminated);
+  CHECK_EQ(server.client().received, 7);
+  printf("buffer of the writer on the stack: %u bytes\n", (uint32_t)sizeof(ResponseWriter));
+  return hostCheckResult("json_responses");
+}
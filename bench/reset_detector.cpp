@@ -0,0 +1,258 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+/**
+ * Host test of the ResetDetector against the ESP8266 stubs in bench/stubs: reset sequences inside
+ * and outside the window, reset reasons which are not counted, invalid RTC content and saturation.
+ * The boot time blocked by the detector and its flash writes are compared with the reset file
+ * handling ConfigFS::setup() used before, which waited with delay(2000) on each boot.
+ *
+ *     g++ -std=c++11 -Wall -DESP8266 -Ibench/stubs -Isrc bench/reset_detector.cpp src/ewcResetDetector.cpp src/ewcLogger.cpp -o reset_detector && ./reset_detector
+ *
+ * Add -DEWC_RESET_DETECTOR_FILE to test the LittleFS fallback. The millis() rollover is not covered,
+ * unsigned long has 64 bit on the host.
+ */
+
+#include <LittleFS.h>
+#include "ewcInterface.h"
+#include "ewcResetDetector.h"
+#include "host_check.h"
+
+using namespace EWC;
+
+HardwareSerial Serial;
+EspClass ESP;
+FS LittleFS;
+unsigned long hostMillis = 0;
+
+Logger &InterfaceData::logger()
+{
+  static Logger logger;
+  return logger;
+}
+
+/** Flash writes of LittleFS and RTC memory writes since the last call. **/
+struct Writes
+{
+  uint32_t flash;
+  uint32_t rtc;
+};
+
+static Writes writes()
+{
+  static Writes last = {0, 0};
+  Writes result = {LittleFS.flashWrites - last.flash, ESP.rtcWrites - last.rtc};
+  last.flash = LittleFS.flashWrites;
+  last.rtc = ESP.rtcWrites;
+  return result;
+}
+
+/** Starts the device: the clock restarts, the RTC memory and the flash are kept. **/
+static uint8_t boot(ResetDetector &detector, uint32_t reason)
+{
+  hostMillis = 0;
+  ESP.resetInfo.reason = reason;
+  detector = ResetDetector();
+  return detector.begin();
+}
+
+/** Runs the loop for the given time. **/
+static void run(ResetDetector &detector, unsigned long ms)
+{
+  for (unsigned long t = 0; t < ms; t += 10)
+  {
+    hostMillis += 10;
+    detector.loop();
+  }
+}
+
+/** Reset file handling of ConfigFS::setup() before the ResetDetector. **/
+static uint8_t legacySetup()
+{
+  uint8_t count = 0;
+  File resetFile = LittleFS.open("/reset.lock", "r");
+  if (resetFile && !resetFile.isDirectory())
+  {
+    count = resetFile.readString().toInt();
+    resetFile.close();
+    if (count == 5)
+    {
+      delay(2000);
+    }
+    resetFile = LittleFS.open("/reset.lock", "w");
+    resetFile.print(count + 1);
+    resetFile.close();
+    delay(2000);
+  }
+  else
+  {
+    resetFile = LittleFS.open("/reset.lock", "w");
+    resetFile.print('1');
+    resetFile.close();
+    delay(2000);
+  }
+  LittleFS.remove("/reset.lock");
+  return count;
+}
+
+static void testWindow()
+{
+  ResetDetector detector;
+  CHECK_EQ(boot(detector, REASON_DEFAULT_RST), 0);
+  CHECK_EQ(millis(), 0);
+  CHECK(detector.waiting());
+  run(detector, EWC_RESET_WINDOW_MS);
+  CHECK(detector.waiting());
+  run(detector, 10);
+  CHECK(!detector.waiting());
+  CHECK_EQ(boot(detector, REASON_EXT_SYS_RST), 0);
+  // reset after the window
+  run(detector, EWC_RESET_WINDOW_MS + 500);
+  CHECK_EQ(boot(detector, REASON_EXT_SYS_RST), 0);
+  run(detector, EWC_RESET_WINDOW_MS + 500);
+}
+
+static void testSequence()
+{
+  ResetDetector detector;
+  // 2 resets select the configuration mode, 5 remove the configuration
+  CHECK_EQ(boot(detector, REASON_DEFAULT_RST), 0);
+  for (uint8_t count = 1; count <= 6; count++)
+  {
+    run(detector, EWC_RESET_WINDOW_MS / 2);
+    CHECK_EQ(boot(detector, REASON_EXT_SYS_RST), count);
+  }
+  run(detector, EWC_RESET_WINDOW_MS + 10);
+  CHECK_EQ(boot(detector, REASON_EXT_SYS_RST), 0);
+  run(detector, EWC_RESET_WINDOW_MS + 10);
+
+  // saturates instead of restarting the sequence
+  boot(detector, REASON_EXT_SYS_RST);
+  uint8_t count = 0;
+  for (int i = 0; i < 300; i++)
+  {
+    count = boot(detector, REASON_EXT_SYS_RST);
+  }
+  CHECK_EQ(count, 255);
+  run(detector, EWC_RESET_WINDOW_MS + 10);
+}
+
+static void testReasons()
+{
+  const uint32_t reasons[] = {REASON_WDT_RST, REASON_EXCEPTION_RST, REASON_SOFT_WDT_RST, REASON_SOFT_RESTART, REASON_DEEP_SLEEP_AWAKE};
+  for (uint32_t reason : reasons)
+  {
+    ResetDetector detector;
+    boot(detector, REASON_DEFAULT_RST);
+    run(detector, 100);
+    CHECK_EQ(boot(detector, REASON_EXT_SYS_RST), 1);
+    run(detector, 100);
+    // not a reset by the user: not counted, the sequence starts again
+    CHECK_EQ(boot(detector, reason), 0);
+    CHECK(!detector.waiting());
+    CHECK_EQ(boot(detector, REASON_EXT_SYS_RST), 0);
+    run(detector, EWC_RESET_WINDOW_MS + 10);
+  }
+}
+
+static void testInvalidMemory()
+{
+  // RTC memory and flash content is random after power on
+  uint32_t seed = 3;
+  for (int i = 0; i < 100; i++)
+  {
+    for (uint32_t &block : ESP.rtcMemory)
+    {
+      seed = seed * 1103515245UL + 12345UL;
+      block = seed;
+    }
+    char text[8];
+    snprintf(text, sizeof(text), "%u", (seed >> 8) % 1000);
+    LittleFS.files["/reset.lock"] = text;
+    ResetDetector detector;
+    CHECK(boot(detector, REASON_DEFAULT_RST) <= 255);
+    run(detector, EWC_RESET_WINDOW_MS + 10);
+    CHECK_EQ(boot(detector, REASON_DEFAULT_RST), 0);
+    run(detector, EWC_RESET_WINDOW_MS + 10);
+  }
+#ifdef EWC_RESET_DETECTOR_USE_RTC
+  uint32_t invalid = 0;
+  for (int i = 0; i < 1000; i++)
+  {
+    for (uint32_t &block : ESP.rtcMemory)
+    {
+      seed = seed * 1103515245UL + 12345UL;
+      block = seed;
+    }
+    ResetDetector detector;
+    invalid += boot(detector, REASON_DEFAULT_RST) == 0 ? 1 : 0;
+  }
+  CHECK_EQ(invalid, 1000);
+#endif
+}
+
+static void testBootTime()
+{
+  const int boots = 10;
+  ResetDetector detector;
+  LittleFS.files.clear();
+  writes();
+  unsigned long blocked = 0;
+  for (int i = 0; i < boots; i++)
+  {
+    boot(detector, REASON_DEFAULT_RST);
+    blocked += millis();
+    run(detector, EWC_RESET_WINDOW_MS + 10);
+  }
+  Writes detectorWrites = writes();
+  unsigned long legacyBlocked = 0;
+  for (int i = 0; i < boots; i++)
+  {
+    hostMillis = 0;
+    legacySetup();
+    legacyBlocked += millis();
+  }
+  Writes legacyWrites = writes();
+  printf("per boot       blocked  flash writes  RTC writes\n");
+  printf("ResetDetector  %4lu ms  %12u  %10u\n", blocked / boots, detectorWrites.flash / boots, detectorWrites.rtc / boots);
+  printf("before         %4lu ms  %12u  %10u\n", legacyBlocked / boots, legacyWrites.flash / boots, legacyWrites.rtc / boots);
+  CHECK_EQ(blocked, 0);
+  CHECK_EQ(legacyBlocked, boots * 2000);
+#ifdef EWC_RESET_DETECTOR_USE_RTC
+  CHECK_EQ(detectorWrites.flash, 0);
+#else
+  CHECK(detectorWrites.flash <= legacyWrites.flash);
+#endif
+}
+
+int main()
+{
+  testWindow();
+  testSequence();
+  testReasons();
+  testInvalidMemory();
+  testBootTime();
+#ifdef EWC_RESET_DETECTOR_USE_RTC
+  return hostCheckResult("reset_detector (RTC)");
+#else
+  return hostCheckResult("reset_detector (LittleFS)");
+#endif
+}
@@ -0,0 +1,222 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+/**
+ * Replays RSSI traces of two access points A and B of the same SSID through the Roaming decision
+ * logic, as done by ConfigServer::_roamingLoop(): one sample of the current access point per
+ * EWC_ROAMING_SAMPLE_MS, a requested scan delivers the other access point after SCAN_DURATION_MS.
+ * The built-in traces are interpolated between key points with +-2 dB noise and checked against the
+ * expected number of scans and roams.
+ *
+ *     g++ -std=c++11 -Wall -Isrc bench/roaming_replay.cpp src/ewcRoaming.cpp -o roaming_replay && ./roaming_replay
+ *
+ * A trace recorded on the device can be replayed by passing a file with one line per sample:
+ * "<ms> <rssi A> <rssi B>", 0 if the access point is not visible. The decisions are printed only.
+ */
+
+#include "ewcRoaming.h"
+#include "host_check.h"
+#include <vector>
+
+using namespace EWC;
+
+#define SCAN_DURATION_MS 2000
+
+struct KeyPoint
+{
+  uint32_t ms;
+  int8_t rssiA;
+  int8_t rssiB;
+};
+
+struct Sample
+{
+  uint32_t ms;
+  int8_t rssi[2];
+};
+
+struct Result
+{
+  uint32_t scans;
+  uint32_t roams;
+  uint32_t stays;
+  uint32_t firstScanMs;
+  uint32_t firstRoamMs;
+  uint8_t ap; //< access point at the end, 0 is A
+};
+
+/** Samples of the key points in EWC_ROAMING_SAMPLE_MS steps with deterministic noise. **/
+static std::vector<Sample> interpolate(const KeyPoint *points, size_t count)
+{
+  std::vector<Sample> samples;
+  uint32_t seed = 7;
+  for (size_t i = 0; i + 1 < count; i++)
+  {
+    const KeyPoint &p0 = points[i];
+    const KeyPoint &p1 = points[i + 1];
+    for (uint32_t ms = p0.ms; ms < p1.ms; ms += EWC_ROAMING_SAMPLE_MS)
+    {
+      Sample sample;
+      sample.ms = ms;
+      int8_t from[2] = {p0.rssiA, p0.rssiB};
+      int8_t to[2] = {p1.rssiA, p1.rssiB};
+      for (int ap = 0; ap < 2; ap++)
+      {
+        seed = seed * 1103515245UL + 12345UL;
+        int32_t noise = (int32_t)((seed >> 16) % 5) - 2;
+        int32_t rssi = from[ap] + (int32_t)(to[ap] - from[ap]) * (int32_t)(ms - p0.ms) / (int32_t)(p1.ms - p0.ms);
+        sample.rssi[ap] = from[ap] == 0 ? 0 : (int8_t)(rssi + noise);
+      }
+      samples.push_back(sample);
+    }
+  }
+  return samples;
+}
+
+/** Replays the samples starting at the clock value start. The first abortScans scans deliver no result. **/
+static Result replay(const char *name, const std::vector<Sample> &samples, uint32_t start, uint32_t abortScans, bool verbose)
+{
+  Result result = {0, 0, 0, 0, 0, 0};
+  Roaming roaming;
+  uint32_t scanDone = 0;
+  bool scanPending = false;
+  for (const Sample &sample : samples)
+  {
+    uint32_t now = start + sample.ms;
+    if (scanPending && (int32_t)(now - scanDone) >= 0)
+    {
+      scanPending = false;
+      int8_t other = sample.rssi[1 - result.ap];
+      int8_t current = sample.rssi[result.ap];
+      // the scan result holds the strongest access point of the SSID
+      bool same = other == 0 || current >= other;
+      Roaming::Decision decision = roaming.evaluate(true, same, same ? current : other);
+      if (verbose)
+      {
+        printf("%s %8u ms: %s, average %d, best %d%s\n", name, sample.ms, Roaming::decisionName(decision), roaming.average(), same ? current : other, same ? " (current)" : "");
+      }
+      if (decision == Roaming::ROAM)
+      {
+        result.roams++;
+        result.firstRoamMs = result.roams == 1 ? sample.ms : result.firstRoamMs;
+        result.ap = 1 - result.ap;
+        roaming.reset();
+        continue;
+      }
+      result.stays++;
+    }
+    if (roaming.sample(sample.rssi[result.ap], now) == Roaming::SCAN)
+    {
+      result.scans++;
+      result.firstScanMs = result.scans == 1 ? sample.ms : result.firstScanMs;
+      if (result.scans > abortScans)
+      {
+        scanPending = true;
+        scanDone = now + SCAN_DURATION_MS;
+      }
+      if (verbose)
+      {
+        printf("%s %8u ms: scan, average %d%s\n", name, sample.ms, roaming.average(), scanPending ? "" : " (aborted)");
+      }
+    }
+  }
+  printf("%-10s %5u samples, %2u scans, %u roams, %2u stays, first scan %6u ms, first roam %6u ms\n", name, (uint32_t)samples.size(), result.scans, result.roams, result.stays, result.firstScanMs, result.firstRoamMs);
+  return result;
+}
+
+static int replayFile(const char *path)
+{
+  FILE *file = fopen(path, "r");
+  if (file == nullptr)
+  {
+    printf("can not open %s\n", path);
+    return EXIT_FAILURE;
+  }
+  std::vector<Sample> samples;
+  unsigned long ms;
+  int rssiA;
+  int rssiB;
+  while (fscanf(file, "%lu %d %d", &ms, &rssiA, &rssiB) == 3)
+  {
+    Sample sample = {(uint32_t)ms, {(int8_t)rssiA, (int8_t)rssiB}};
+    samples.push_back(sample);
+  }
+  fclose(file);
+  replay(path, samples, 0, 0, true);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc > 1)
+  {
+    return replayFile(argv[1]);
+  }
+  // good signal at the desk, B is in another room: never scans
+  const KeyPoint desk[] = {{0, -52, -80}, {600000, -52, -80}};
+  Result r = replay("desk", interpolate(desk, 2), 0, 0, false);
+  CHECK_EQ(r.scans, 0);
+  CHECK_EQ(r.roams, 0);
+
+  // short dip below the threshold, e.g. a person in front of the antenna: smoothed by the average
+  const KeyPoint dip[] = {{0, -62, -55}, {100000, -62, -55}, {100000, -90, -55}, {104000, -90, -55}, {104000, -62, -55}, {300000, -62, -55}};
+  r = replay("dip", interpolate(dip, 6), 0, 0, false);
+  CHECK_EQ(r.scans, 0);
+  CHECK_EQ(r.roams, 0);
+
+  // walk from A to B: roams once to B after the average of A fell below the threshold, then stays on B
+  const KeyPoint walk[] = {{0, -50, -88}, {120000, -88, -50}, {300000, -88, -50}};
+  std::vector<Sample> walkSamples = interpolate(walk, 3);
+  r = replay("walk", walkSamples, 0, 0, false);
+  CHECK_EQ(r.roams, 1);
+  CHECK_EQ(r.ap, 1);
+  CHECK_EQ(r.scans, 1);
+  CHECK(r.firstScanMs > 70000 && r.firstScanMs < 100000);
+  CHECK_EQ(r.firstRoamMs, r.firstScanMs + SCAN_DURATION_MS);
+
+  // B is better but inside the hysteresis: stays, scans once per scan interval
+  const KeyPoint edge[] = {{0, -79, -74}, {600000, -79, -74}};
+  std::vector<Sample> edgeSamples = interpolate(edge, 2);
+  r = replay("edge", edgeSamples, 0, 0, false);
+  CHECK_EQ(r.roams, 0);
+  CHECK_EQ(r.scans, 10);
+  CHECK_EQ(r.stays, 10);
+  CHECK_EQ(r.firstScanMs, (1 << EWC_ROAMING_EMA_SHIFT) * EWC_ROAMING_SAMPLE_MS);
+  // the same across the millis() rollover
+  r = replay("edge-wrap", edgeSamples, 0xFFFFFFFFUL - 100000, 0, false);
+  CHECK_EQ(r.scans, 10);
+  CHECK_EQ(r.stays, 10);
+
+  // the first scan is aborted: dropped after the scan timeout, the next scan waits for the scan interval
+  const KeyPoint aborted[] = {{0, -82, -60}, {300000, -82, -60}};
+  r = replay("aborted", interpolate(aborted, 2), 0, 1, false);
+  CHECK_EQ(r.scans, 2);
+  CHECK_EQ(r.roams, 1);
+  CHECK_EQ(r.firstRoamMs, r.firstScanMs + EWC_ROAMING_SCAN_INTERVAL_MS + SCAN_DURATION_MS);
+
+  // walk to B and back to the middle: B falls below the threshold, but no ping pong while A is inside the hysteresis
+  const KeyPoint corridor[] = {{0, -50, -88}, {120000, -88, -50}, {180000, -74, -78}, {480000, -74, -78}};
+  r = replay("corridor", interpolate(corridor, 4), 0, 0, false);
+  CHECK_EQ(r.roams, 1);
+  CHECK_EQ(r.ap, 1);
+  CHECK(r.stays >= 4);
+  return hostCheckResult("roaming_replay");
+}
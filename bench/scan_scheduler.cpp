@@ -0,0 +1,185 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+/**
+ * Host test of the ScanScheduler: full scan without AP clients, channel sweep in idle gaps with AP
+ * clients, sweep interval, scan timeout and the millis() rollover. The portal simulation checks that
+ * no channel scan starts within EWC_SCAN_IDLE_MS of an HTTP request.
+ *
+ *     g++ -std=c++11 -Wall -Isrc bench/scan_scheduler.cpp src/ewcScanScheduler.cpp -o scan_scheduler && ./scan_scheduler
+ */
+
+#include "ewcScanScheduler.h"
+#include "host_check.h"
+
+using namespace EWC;
+
+static void testFullScan(uint32_t now)
+{
+  ScanScheduler scheduler;
+  CHECK_EQ(scheduler.next(now, false), ScanScheduler::NO_SCAN);
+  scheduler.request(now);
+  CHECK(scheduler.sweeping());
+  CHECK_EQ(scheduler.next(now, false), ScanScheduler::ALL_CHANNELS);
+  CHECK(scheduler.scanning());
+  CHECK(scheduler.lastOfSweep());
+  // one scan at a time
+  CHECK_EQ(scheduler.next(now + 100, false), ScanScheduler::NO_SCAN);
+  now += 2000;
+  scheduler.finished(now);
+  CHECK(!scheduler.sweeping());
+  CHECK(!scheduler.scanning());
+  CHECK_EQ(scheduler.sweeps(), 1);
+  // a second finished() is ignored
+  scheduler.finished(now + 10);
+  CHECK_EQ(scheduler.sweeps(), 1);
+
+  // requests inside the sweep interval are ignored, except forced ones
+  scheduler.request(now + EWC_SCAN_INTERVAL_MS - 1);
+  CHECK(!scheduler.sweeping());
+  CHECK_EQ(scheduler.next(now + EWC_SCAN_INTERVAL_MS - 1, false), ScanScheduler::NO_SCAN);
+  scheduler.request(now + 1, true);
+  CHECK(scheduler.sweeping());
+  CHECK_EQ(scheduler.next(now + 1, false), ScanScheduler::ALL_CHANNELS);
+  scheduler.finished(now + 2000);
+  CHECK_EQ(scheduler.sweeps(), 2);
+  now += 2000;
+  scheduler.request(now + EWC_SCAN_INTERVAL_MS);
+  CHECK(scheduler.sweeping());
+}
+
+static void testChannelSweep(uint32_t now)
+{
+  ScanScheduler scheduler;
+  scheduler.activity(now);
+  scheduler.request(now);
+  // waits for an idle gap after the last HTTP request
+  CHECK_EQ(scheduler.next(now + EWC_SCAN_IDLE_MS - 1, true), ScanScheduler::NO_SCAN);
+  now += EWC_SCAN_IDLE_MS;
+  for (int channel = 1; channel <= EWC_SCAN_CHANNELS; channel++)
+  {
+    CHECK_EQ(scheduler.next(now, true), channel);
+    CHECK_EQ(scheduler.channel(), channel);
+    CHECK_EQ(scheduler.lastOfSweep(), channel == EWC_SCAN_CHANNELS);
+    now += EWC_SCAN_CHANNEL_DWELL_MS;
+    scheduler.finished(now);
+    // gap between two channel scans
+    CHECK_EQ(scheduler.next(now + EWC_SCAN_CHANNEL_GAP_MS - 1, true), ScanScheduler::NO_SCAN);
+    now += EWC_SCAN_CHANNEL_GAP_MS;
+  }
+  CHECK(!scheduler.sweeping());
+  CHECK_EQ(scheduler.sweeps(), 1);
+  CHECK_EQ(scheduler.next(now, true), ScanScheduler::NO_SCAN);
+
+  // the clients leave during the sweep: the remaining channels follow without gaps
+  scheduler.request(now, true);
+  now += EWC_SCAN_IDLE_MS;
+  CHECK_EQ(scheduler.next(now, true), 1);
+  scheduler.finished(now + EWC_SCAN_CHANNEL_DWELL_MS);
+  CHECK_EQ(scheduler.next(now + EWC_SCAN_CHANNEL_DWELL_MS, true), ScanScheduler::NO_SCAN);
+  for (int channel = 2; channel <= EWC_SCAN_CHANNELS; channel++)
+  {
+    CHECK_EQ(scheduler.next(now, false), channel);
+    scheduler.finished(now);
+  }
+  CHECK_EQ(scheduler.sweeps(), 2);
+  CHECK(!scheduler.sweeping());
+}
+
+static void testTimeout(uint32_t now)
+{
+  ScanScheduler scheduler;
+  CHECK(!scheduler.timedOut(now));
+  scheduler.request(now);
+  scheduler.next(now, false);
+  CHECK(!scheduler.timedOut(now + EWC_SCAN_TIMEOUT_MS));
+  CHECK(scheduler.timedOut(now + EWC_SCAN_TIMEOUT_MS + 1));
+  // ConfigServer drops the scan by finished()
+  scheduler.finished(now + EWC_SCAN_TIMEOUT_MS + 1);
+  CHECK(!scheduler.timedOut(now + EWC_SCAN_TIMEOUT_MS + 1));
+  CHECK_EQ(scheduler.sweeps(), 1);
+}
+
+/** HTTP requests in bursts, each scan is checked against the last request. **/
+static void testPortalSimulation(uint32_t start)
+{
+  ScanScheduler scheduler;
+  uint32_t lastRequest = start;
+  uint32_t scans = 0;
+  uint32_t tooEarly = 0;
+  uint32_t scanEnd = 0;
+  uint32_t sweepStart = start;
+  uint32_t longestSweep = 0;
+  scheduler.activity(start);
+  scheduler.request(start);
+  for (uint32_t t = 0; t < 600000; t += 10)
+  {
+    uint32_t now = start + t;
+    // a page load every 3 s: 5 requests 100 ms apart
+    if (t % 3000 < 500 && t % 100 == 0)
+    {
+      scheduler.activity(now);
+      lastRequest = now;
+    }
+    if (scheduler.scanning() && now == scanEnd)
+    {
+      bool last = scheduler.lastOfSweep();
+      scheduler.finished(now);
+      if (last)
+      {
+        uint32_t duration = now - sweepStart;
+        longestSweep = duration > longestSweep ? duration : longestSweep;
+      }
+    }
+    if (!scheduler.sweeping())
+    {
+      // the portal polls the scan result, a new sweep starts after the interval
+      scheduler.request(now);
+      sweepStart = now;
+    }
+    int8_t channel = scheduler.next(now, true);
+    if (channel != ScanScheduler::NO_SCAN)
+    {
+      scans++;
+      tooEarly += now - lastRequest < EWC_SCAN_IDLE_MS ? 1 : 0;
+      scanEnd = now + EWC_SCAN_CHANNEL_DWELL_MS;
+    }
+  }
+  printf("portal from %10u: %u channel scans, %u sweeps, longest sweep %u ms, %u scans within %u ms of a request\n", start, scans, scheduler.sweeps(), longestSweep, tooEarly, EWC_SCAN_IDLE_MS);
+  CHECK_EQ(tooEarly, 0);
+  CHECK(scheduler.sweeps() > 0);
+  CHECK_EQ(scans / EWC_SCAN_CHANNELS, scheduler.sweeps());
+  CHECK(longestSweep < 3 * 3000 + EWC_SCAN_INTERVAL_MS);
+}
+
+int main()
+{
+  testFullScan(100000);
+  testChannelSweep(100000);
+  testTimeout(100000);
+  testPortalSimulation(100000);
+  // the same across the millis() rollover
+  testFullScan(0xFFFFFFFFUL - 1000);
+  testChannelSweep(0xFFFFFFFFUL - 2000);
+  testTimeout(0xFFFFFFFFUL - 5000);
+  testPortalSimulation(0xFFFFFFFFUL - 300000);
+  return hostCheckResult("scan_scheduler");
+}
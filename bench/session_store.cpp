@@ -0,0 +1,201 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+/**
+ * Host test of the SessionStore: cookie format, token verification, sliding expiry, eviction of
+ * the least recently used session, clear() and the millis() rollover.
+ *
+ *     g++ -std=c++11 -Wall -Isrc bench/session_store.cpp src/ewcSessionStore.cpp -o session_store && ./session_store
+ */
+
+#include "ewcSessionStore.h"
+#include "host_check.h"
+#include <string.h>
+#include <string>
+
+using namespace EWC;
+typedef char Value[SessionStore::VALUE_SIZE];
+
+static uint32_t randomState = 1;
+
+static uint32_t randomNext()
+{
+  randomState = randomState * 1103515245UL + 12345UL;
+  return randomState;
+}
+
+static std::string cookie(const char *value)
+{
+  return std::string("lang=de; " EWC_SESSION_COOKIE "=") + value + "; theme=dark";
+}
+
+static void testToken(uint32_t now)
+{
+  SessionStore store(randomNext);
+  CHECK_EQ(store.active(now), 0);
+  Value value;
+  store.create(now, value);
+  CHECK_EQ(strlen(value), SessionStore::VALUE_SIZE - 1);
+  CHECK(value[0] >= '0' && value[0] < '0' + EWC_SESSIONS);
+  CHECK_EQ(strspn(value + 1, "0123456789abcdef"), 2 * EWC_SESSION_TOKEN_SIZE);
+  CHECK_EQ(store.active(now), 1);
+  CHECK(store.check(cookie(value).c_str(), now));
+  CHECK(store.check((std::string(EWC_SESSION_COOKIE "=") + value).c_str(), now));
+
+  CHECK(!store.check(nullptr, now));
+  CHECK(!store.check("", now));
+  CHECK(!store.check("lang=de", now));
+  // each changed digit is rejected
+  for (size_t i = 1; i < SessionStore::VALUE_SIZE - 1; i++)
+  {
+    Value changed;
+    memcpy(changed, value, sizeof(changed));
+    changed[i] = changed[i] == '0' ? '1' : '0';
+    CHECK(!store.check(cookie(changed).c_str(), now));
+  }
+  Value upper;
+  memcpy(upper, value, sizeof(upper));
+  for (char &c : upper)
+  {
+    c = c >= 'a' && c <= 'f' ? c - 'a' + 'A' : c;
+  }
+  CHECK(strcmp(upper, value) == 0 || !store.check(cookie(upper).c_str(), now));
+  Value invalid;
+  memcpy(invalid, value, sizeof(invalid));
+  invalid[5] = 'x';
+  CHECK(!store.check(cookie(invalid).c_str(), now));
+  // the bits of an invalid digit are all set like those of 'f'
+  SessionStore digits(randomNext);
+  Value withF;
+  do
+  {
+    digits.create(now, withF);
+  } while (strchr(withF + 1, 'f') == nullptr);
+  for (size_t i = 1; i < SessionStore::VALUE_SIZE - 1; i++)
+  {
+    if (withF[i] == 'f')
+    {
+      memcpy(invalid, withF, sizeof(invalid));
+      invalid[i] = 'X';
+      CHECK(!digits.check(cookie(invalid).c_str(), now));
+    }
+  }
+  CHECK(digits.check(cookie(withF).c_str(), now));
+  // truncated token, unknown slot
+  CHECK(!store.check((std::string(EWC_SESSION_COOKIE "=") + std::string(value, SessionStore::VALUE_SIZE - 2)).c_str(), now));
+  Value slot;
+  memcpy(slot, value, sizeof(slot));
+  slot[0] = '0' + EWC_SESSIONS;
+  CHECK(!store.check(cookie(slot).c_str(), now));
+  // the token of an other session in the same slot is rejected
+  SessionStore other(randomNext);
+  Value otherValue;
+  other.create(now, otherValue);
+  CHECK_EQ(otherValue[0], value[0]);
+  CHECK(!store.check(cookie(otherValue).c_str(), now));
+}
+
+static void testExpiry(uint32_t now)
+{
+  SessionStore store(randomNext);
+  Value value;
+  store.create(now, value);
+  CHECK(store.check(cookie(value).c_str(), now + EWC_SESSION_TTL_MS));
+  // each use extends the expiry
+  now += EWC_SESSION_TTL_MS;
+  CHECK(store.check(cookie(value).c_str(), now + EWC_SESSION_TTL_MS));
+  now += EWC_SESSION_TTL_MS;
+  CHECK_EQ(store.active(now + EWC_SESSION_TTL_MS), 1);
+  CHECK_EQ(store.active(now + EWC_SESSION_TTL_MS + 1), 0);
+  CHECK(!store.check(cookie(value).c_str(), now + EWC_SESSION_TTL_MS + 1));
+}
+
+static void testEviction(uint32_t now)
+{
+  SessionStore store(randomNext);
+  Value values[EWC_SESSIONS];
+  for (uint8_t i = 0; i < EWC_SESSIONS; i++)
+  {
+    store.create(now + i, values[i]);
+    CHECK_EQ(values[i][0], '0' + i);
+  }
+  CHECK_EQ(store.active(now + EWC_SESSIONS), EWC_SESSIONS);
+  // slot 0 is used again, slot 1 is the least recently used now
+  CHECK(store.check(cookie(values[0]).c_str(), now + 100));
+  Value added;
+  store.create(now + 200, added);
+  CHECK_EQ(added[0], '1');
+  CHECK(!store.check(cookie(values[1]).c_str(), now + 200));
+  CHECK(store.check(cookie(added).c_str(), now + 200));
+  for (uint8_t i = 0; i < EWC_SESSIONS; i++)
+  {
+    CHECK_EQ(store.check(cookie(values[i]).c_str(), now + 300), i != 1);
+  }
+  // an expired slot is used before the least recently used one
+  uint32_t later = now + 300 + EWC_SESSION_TTL_MS / 2;
+  for (uint8_t i = 0; i < EWC_SESSIONS; i++)
+  {
+    if (i != 2)
+    {
+      store.check(cookie(i == 1 ? added : values[i]).c_str(), later);
+    }
+  }
+  later = now + 300 + EWC_SESSION_TTL_MS + 1;
+  CHECK_EQ(store.active(later), EWC_SESSIONS - 1);
+  store.create(later, added);
+  CHECK_EQ(added[0], '2');
+  CHECK_EQ(store.active(later), EWC_SESSIONS);
+}
+
+static void testClear(uint32_t now)
+{
+  SessionStore store(randomNext);
+  Value values[EWC_SESSIONS];
+  for (uint8_t i = 0; i < EWC_SESSIONS; i++)
+  {
+    store.create(now, values[i]);
+  }
+  store.clear();
+  CHECK_EQ(store.active(now), 0);
+  for (uint8_t i = 0; i < EWC_SESSIONS; i++)
+  {
+    CHECK(!store.check(cookie(values[i]).c_str(), now));
+  }
+  // an all zero token is not valid after clear()
+  Value zero;
+  memset(zero, '0', sizeof(zero));
+  zero[SessionStore::VALUE_SIZE - 1] = '\0';
+  CHECK(!store.check(cookie(zero).c_str(), now));
+}
+
+int main()
+{
+  testToken(1000);
+  testExpiry(1000);
+  testEviction(1000);
+  testClear(1000);
+  // the same across the millis() rollover
+  testToken(0xFFFFFFFFUL - 10);
+  testExpiry(0xFFFFFFFFUL - EWC_SESSION_TTL_MS / 2);
+  testEviction(0xFFFFFFFFUL - 150);
+  testClear(0xFFFFFFFFUL);
+  return hostCheckResult("session_store");
+}
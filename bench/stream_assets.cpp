@@ -0,0 +1,112 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+/**
+ * Host test of the streaming of the gzip web assets from flash by ResponseWriter::sendP(), used by
+ * ConfigServer::_sendContentNoAuthG(). The peak heap while sending is compared with the String copy
+ * the ESP32 path made before. The assets have the gzip -9 size of the unminified files in web/ and
+ * two larger sizes, the content is random.
+ *
+ *     g++ -std=c++11 -Wall -DESP8266 -Ibench/stubs -Isrc bench/stream_assets.cpp src/ewcResponseWriter.cpp -o stream_assets && ./stream_assets
+ */
+
+#include "ewcResponseWriter.h"
+#include "host_check.h"
+#include "host_heap.h"
+
+using namespace EWC;
+
+#define FLASH_SIZE (256 * 1024)
+
+HardwareSerial Serial;
+EspClass ESP;
+unsigned long hostMillis = 0;
+
+/** Stands for the PROGMEM arrays, not counted as heap. **/
+static char flash[FLASH_SIZE];
+
+static uint32_t fnv(const char *content, size_t size)
+{
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash = (hash ^ (uint8_t)content[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+struct Asset
+{
+  const char *name;
+  size_t size;
+};
+
+int main()
+{
+  uint32_t seed = 5;
+  for (char &c : flash)
+  {
+    seed = seed * 1103515245UL + 12345UL;
+    c = (char)(seed >> 24);
+  }
+  const Asset assets[] = {{"wifiIcons.css", 1371}, {"wifi.js", 1689}, {"postload.js", 1942}, {"base.css", 2894}, {"64 KB", 64 * 1024}, {"256 KB", FLASH_SIZE}};
+  const String contentType("text/css");
+  printf("asset           size  chunks  peak heap streamed  peak heap String copy\n");
+  for (const Asset &asset : assets)
+  {
+    ESP8266WebServer server;
+    heapMark();
+    size_t sent;
+    {
+      ResponseWriter writer(&server);
+      sent = writer.sendP(200, contentType, flash, asset.size);
+    }
+    size_t streamed = heapPeak();
+    CHECK_EQ(sent, asset.size);
+    CHECK_EQ(server.code, 200);
+    CHECK_EQ(server.contentLength, asset.size);
+    CHECK_EQ(server.hash, fnv(flash, asset.size));
+    CHECK(server.maxChunk <= EWC_STREAM_CHUNK_SIZE);
+    CHECK_EQ(server.chunks, (asset.size + EWC_STREAM_CHUNK_SIZE - 1) / EWC_STREAM_CHUNK_SIZE);
+    CHECK(!server.terminated);
+    CHECK_EQ(streamed, 0);
+
+    // ESP32 before: webServer->send(200, contentType.c_str(), String(content, len))
+    ESP8266WebServer before;
+    heapMark();
+    before.send(200, contentType.c_str(), String(flash, asset.size));
+    size_t copied = heapPeak();
+    CHECK_EQ(before.hash, server.hash);
+    CHECK(copied >= asset.size);
+    printf("%-13s %6u  %6u  %18u  %21u\n", asset.name, (uint32_t)asset.size, (uint32_t)server.chunks, (uint32_t)streamed, (uint32_t)copied);
+  }
+
+  // a client which disconnects stops the stream at the next chunk
+  ESP8266WebServer server;
+  server.client().disconnectAfter = 3000;
+  ResponseWriter writer(&server);
+  size_t sent = writer.sendP(200, contentType, flash, assets[4].size);
+  CHECK(sent >= 3000 && sent < assets[4].size);
+  CHECK(sent - 3000 < EWC_STREAM_CHUNK_SIZE);
+  CHECK_EQ(writer.written(), sent);
+  printf("disconnect after 3000 bytes: %u of %u sent, stack of the writer %u bytes\n", (uint32_t)sent, (uint32_t)assets[4].size, (uint32_t)sizeof(ResponseWriter));
+  return hostCheckResult("stream_assets");
+}
@@ -0,0 +1,130 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_STUB_ARDUINO_H
+#define EWC_STUB_ARDUINO_H
+
+/**
+ * Minimal Arduino core of ESP8266 for the host tests of modules which need only
+ * millis(), Print, String, Serial, PROGMEM access and the RTC user memory. The clock
+ * and the reset reason are set by the test, the RTC memory survives a simulated reset.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "user_interface.h"
+
+#define PROGMEM
+#define PGM_P const char *
+#define F(s) (s)
+#define FPSTR(p) (p)
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+class String : public std::string
+{
+public:
+  String() {}
+  String(const char *s) : std::string(s) {}
+  String(const char *s, size_t len) : std::string(s, len) {}
+  String(const std::string &s) : std::string(s) {}
+  long toInt() const { return atol(c_str()); }
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--)
+    {
+      n += write(*buffer++);
+    }
+    return n;
+  }
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.size()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return print(std::to_string(v).c_str()); }
+  size_t print(unsigned int v) { return print(std::to_string(v).c_str()); }
+  size_t print(long v) { return print(std::to_string(v).c_str()); }
+  size_t print(unsigned long v) { return print(std::to_string(v).c_str()); }
+  size_t println() { return print("\n"); }
+  virtual void flush() {}
+};
+
+class HardwareSerial : public Print
+{
+public:
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+  void begin(unsigned long baud) { _baud = baud; }
+  void end() {}
+  int available() { return 0; }
+  unsigned long baudRate() { return _baud; }
+
+private:
+  unsigned long _baud = 115200;
+};
+extern HardwareSerial Serial;
+
+/** Clock of the test, advanced by delay(). **/
+extern unsigned long hostMillis;
+inline unsigned long millis() { return hostMillis; }
+inline void delay(unsigned long ms) { hostMillis += ms; }
+inline void yield() {}
+
+class EspClass
+{
+public:
+  rst_info resetInfo;
+  uint32_t rtcMemory[128];
+
+  rst_info *getResetInfoPtr() { return &resetInfo; }
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size)
+  {
+    if (offset * 4 + size > sizeof(rtcMemory) || (size & 3) != 0)
+    {
+      return false;
+    }
+    memcpy(data, rtcMemory + offset, size);
+    return true;
+  }
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size)
+  {
+    if (offset * 4 + size > sizeof(rtcMemory) || (size & 3) != 0)
+    {
+      return false;
+    }
+    memcpy(rtcMemory + offset, data, size);
+    rtcWrites++;
+    return true;
+  }
+  uint32_t rtcWrites = 0;
+};
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,90 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_STUB_ESP8266_WEB_SERVER_H
+#define EWC_STUB_ESP8266_WEB_SERVER_H
+
+/**
+ * Web server whose client does not store the body: the sent bytes are counted and
+ * hashed, so the stub itself does not allocate while a response is measured.
+ * The client disconnects after disconnectAfter body bytes.
+ */
+
+#include "Arduino.h"
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+class WiFiClient
+{
+public:
+  size_t disconnectAfter = (size_t)-1;
+  size_t received = 0;
+  bool connected() const { return received < disconnectAfter; }
+};
+
+class ESP8266WebServer
+{
+public:
+  int code = 0;
+  size_t contentLength = 0;
+  size_t chunks = 0;
+  size_t maxChunk = 0;
+  bool terminated = false; //< empty chunk received
+  uint32_t hash = 2166136261UL;
+
+  WiFiClient &client() { return _client; }
+  void setContentLength(size_t length) { contentLength = length; }
+  void sendHeader(const String &, const String &) {}
+  void send(int status, const char *, const String &content)
+  {
+    code = status;
+    _body(content.c_str(), content.size());
+  }
+  void sendContent(const char *content, size_t size) { _body(content, size); }
+  void sendContent(const String &content)
+  {
+    if (content.empty())
+    {
+      terminated = true;
+    }
+    _body(content.c_str(), content.size());
+  }
+  void sendContent_P(PGM_P content, size_t size) { _body(content, size); }
+
+private:
+  WiFiClient _client;
+
+  void _body(const char *content, size_t size)
+  {
+    if (size == 0)
+    {
+      return;
+    }
+    chunks++;
+    maxChunk = size > maxChunk ? size : maxChunk;
+    for (size_t i = 0; i < size; i++)
+    {
+      hash = (hash ^ (uint8_t)content[i]) * 16777619UL;
+    }
+    _client.received += size;
+  }
+};
+
+#endif
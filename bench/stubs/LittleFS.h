@@ -0,0 +1,104 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_STUB_LITTLEFS_H
+#define EWC_STUB_LITTLEFS_H
+
+/**
+ * LittleFS in memory. Counts the operations which write to flash: each closed
+ * written file and each removed file.
+ */
+
+#include <map>
+#include "Arduino.h"
+
+class FS;
+
+class File : public Print
+{
+public:
+  File() {}
+  File(FS *fs, const std::string &path, bool write, const std::string &content)
+      : _fs(fs), _path(path), _write(write), _content(content) {}
+  explicit operator bool() const { return _fs != nullptr; }
+  bool isDirectory() const { return false; }
+  const char *name() const { return _path.c_str(); }
+  String readString()
+  {
+    String result(_content.substr(_pos));
+    _pos = _content.size();
+    return result;
+  }
+  size_t write(uint8_t c) override
+  {
+    _content.push_back((char)c);
+    return 1;
+  }
+  void close();
+
+private:
+  FS *_fs = nullptr;
+  std::string _path;
+  bool _write = false;
+  std::string _content;
+  size_t _pos = 0;
+};
+
+class FS
+{
+public:
+  std::map<std::string, std::string> files;
+  uint32_t flashWrites = 0;
+
+  File open(const char *path, const char *mode)
+  {
+    bool write = mode[0] == 'w';
+    auto it = files.find(path);
+    if (!write && it == files.end())
+    {
+      return File();
+    }
+    return File(this, path, write, write ? std::string() : it->second);
+  }
+  bool remove(const char *path)
+  {
+    if (files.erase(path) == 0)
+    {
+      return false;
+    }
+    flashWrites++;
+    return true;
+  }
+  bool exists(const char *path) const { return files.count(path) > 0; }
+};
+
+inline void File::close()
+{
+  if (_fs != nullptr && _write)
+  {
+    _fs->files[_path] = _content;
+    _fs->flashWrites++;
+  }
+  _fs = nullptr;
+}
+
+extern FS LittleFS;
+
+#endif
@@ -0,0 +1,256 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+/**
+ * Host test of the WiFiStateMachine: backoff doubling and cap, jitter bounds, deadlines across
+ * the millis() rollover, portal timeout and the wrap of the trace ring.
+ * The clock and the random source are injected, no WiFi library is needed.
+ *
+ *     g++ -std=c++11 -Wall -Isrc bench/wifi_state_machine.cpp src/ewcWiFiStateMachine.cpp -o wifi_state_machine && ./wifi_state_machine
+ */
+
+#include "ewcWiFiStateMachine.h"
+#include "host_check.h"
+
+using namespace EWC;
+typedef WiFiStateMachine SM;
+
+static uint32_t now = 0;
+static uint32_t randomValue = 0;
+
+static uint32_t clockNow() { return now; }
+static uint32_t randomNext() { return randomValue; }
+
+static void testBackoff()
+{
+  SM sm(clockNow);
+  sm.setBackoff(10000, 300000);
+  CHECK_EQ(sm.backoff(0), 10000);
+  CHECK_EQ(sm.backoff(1), 10000);
+  CHECK_EQ(sm.backoff(2), 20000);
+  CHECK_EQ(sm.backoff(3), 40000);
+  CHECK_EQ(sm.backoff(5), 160000);
+  // 320000 is capped
+  CHECK_EQ(sm.backoff(6), 300000);
+  CHECK_EQ(sm.backoff(1000), 300000);
+  // no overflow near the uint32 limit
+  sm.setBackoff(0x40000000UL, 0xF0000000UL);
+  CHECK_EQ(sm.backoff(2), 0x80000000UL);
+  CHECK_EQ(sm.backoff(3), 0xF0000000UL);
+  CHECK_EQ(sm.backoff(40), 0xF0000000UL);
+  // max lower than min is raised to min
+  sm.setBackoff(5000, 1000);
+  CHECK_EQ(sm.backoff(4), 5000);
+
+  // each failed attempt doubles the delay until the next connect
+  now = 1000;
+  sm.setBackoff(10000, 40000);
+  sm.handle(SM::EV_BEGIN);
+  uint32_t expected[] = {10000, 20000, 40000, 40000};
+  for (uint32_t delay : expected)
+  {
+    sm.handle(SM::EV_DISCONNECTED, 2);
+    CHECK_EQ(sm.state(), SM::BACKOFF);
+    CHECK_EQ(sm.remaining(), delay);
+    now += delay;
+    CHECK_EQ(sm.poll(false), SM::ACT_CONNECT);
+    CHECK_EQ(sm.state(), SM::CONNECTING);
+  }
+  CHECK_EQ(sm.attempts(), 4);
+  sm.handle(SM::EV_CONNECTED);
+  CHECK_EQ(sm.attempts(), 0);
+  sm.handle(SM::EV_DISCONNECTED);
+  CHECK_EQ(sm.remaining(), 10000);
+}
+
+static void testJitter()
+{
+  SM sm(clockNow, randomNext);
+  sm.setBackoff(10000, 80000);
+  now = 0;
+  // the lowest and highest random value give the bounds of the equal jitter: [delay / 2, delay]
+  uint32_t randoms[] = {0, 1, 12345, 0x7FFFFFFFUL, 0xFFFFFFFFUL};
+  for (uint32_t r : randoms)
+  {
+    randomValue = r;
+    sm.handle(SM::EV_BEGIN);
+    for (uint32_t attempt = 1; attempt <= 6; attempt++)
+    {
+      sm.handle(SM::EV_DISCONNECTED);
+      uint32_t delay = sm.backoff(attempt);
+      uint32_t remaining = sm.remaining();
+      CHECK(remaining >= delay / 2);
+      CHECK(remaining <= delay);
+      sm.handle(SM::EV_RETRY);
+    }
+  }
+  randomValue = 0;
+  sm.handle(SM::EV_BEGIN);
+  sm.handle(SM::EV_DISCONNECTED);
+  CHECK_EQ(sm.remaining(), 5000);
+  randomValue = 5000;
+  sm.handle(SM::EV_BEGIN);
+  sm.handle(SM::EV_DISCONNECTED);
+  CHECK_EQ(sm.remaining(), 10000);
+  // the spread covers the whole range: 1000 draws of a LCG hit both quarters
+  uint32_t seed = 1;
+  bool low = false;
+  bool high = false;
+  for (int i = 0; i < 1000; i++)
+  {
+    seed = seed * 1103515245UL + 12345UL;
+    randomValue = seed;
+    sm.handle(SM::EV_BEGIN);
+    sm.handle(SM::EV_DISCONNECTED);
+    uint32_t remaining = sm.remaining();
+    CHECK(remaining >= 5000 && remaining <= 10000);
+    low = low || remaining < 6250;
+    high = high || remaining > 8750;
+  }
+  CHECK(low && high);
+}
+
+static void testRollover()
+{
+  SM sm(clockNow);
+  sm.setConnectTimeout(60000);
+  sm.setBackoff(10000, 300000);
+  now = 0xFFFFFFFFUL - 30000;
+  CHECK_EQ(sm.handle(SM::EV_BEGIN), SM::ACT_CONNECT);
+  CHECK_EQ(sm.remaining(), 60000);
+  CHECK_EQ(sm.poll(true), SM::ACT_NONE);
+  CHECK_EQ(sm.state(), SM::CONNECTING);
+  // the deadline is behind the rollover
+  now += 59999;
+  CHECK_EQ(sm.remaining(), 1);
+  CHECK_EQ(sm.poll(true), SM::ACT_NONE);
+  CHECK_EQ(sm.state(), SM::CONNECTING);
+  now += 1;
+  CHECK_EQ(sm.remaining(), 0);
+  CHECK_EQ(sm.poll(true), SM::ACT_START_AP);
+  CHECK_EQ(sm.state(), SM::BACKOFF);
+  CHECK_EQ(sm.remaining(), 10000);
+  // the backoff deadline started before and ends after the rollover
+  now = 0xFFFFFFFFUL - 4000;
+  sm.handle(SM::EV_BEGIN);
+  sm.handle(SM::EV_DISCONNECTED);
+  now += 9999;
+  CHECK_EQ(sm.poll(true), SM::ACT_NONE);
+  CHECK_EQ(sm.remaining(), 1);
+  now += 1;
+  CHECK_EQ(sm.poll(true), SM::ACT_CONNECT);
+  CHECK_EQ(sm.state(), SM::CONNECTING);
+}
+
+static void testPortalTimeout()
+{
+  SM sm(clockNow);
+  sm.setPortalTimeout(300000);
+  now = 0xFFFFFFFFUL - 1000;
+  sm.handle(SM::EV_BEGIN);
+  CHECK_EQ(sm.handle(SM::EV_DISCONNECTED), SM::ACT_START_AP);
+  sm.portalStarted(false);
+  CHECK_EQ(sm.portal(), SM::PORTAL_ON);
+  // a running portal is not started again
+  sm.handle(SM::EV_RETRY);
+  CHECK_EQ(sm.handle(SM::EV_DISCONNECTED), SM::ACT_NONE);
+  now += 299999;
+  CHECK(!(sm.poll(true) & SM::ACT_STOP_AP));
+  now += 1;
+  // not disabled while a client is connected to the AP
+  CHECK(!(sm.poll(false) & SM::ACT_STOP_AP));
+  CHECK_EQ(sm.portal(), SM::PORTAL_ON);
+  CHECK(sm.poll(true) & SM::ACT_STOP_AP);
+  CHECK_EQ(sm.portal(), SM::PORTAL_TIMED_OUT);
+  CHECK(!(sm.poll(true) & SM::ACT_STOP_AP));
+  // disabled until the next connect
+  sm.handle(SM::EV_RETRY);
+  CHECK_EQ(sm.handle(SM::EV_DISCONNECTED), SM::ACT_NONE);
+  CHECK_EQ(sm.handle(SM::EV_NO_SSID), SM::ACT_NONE);
+  sm.handle(SM::EV_RETRY);
+  CHECK_EQ(sm.handle(SM::EV_CONNECTED), SM::ACT_CONNECTED);
+  CHECK_EQ(sm.portal(), SM::PORTAL_OFF);
+  CHECK_EQ(sm.handle(SM::EV_DISCONNECTED), SM::ACT_START_AP);
+
+  // AP always on: never disabled by timeout
+  sm.portalStarted(true);
+  now += 10 * 300000;
+  CHECK(!(sm.poll(true) & SM::ACT_STOP_AP));
+  CHECK_EQ(sm.portal(), SM::PORTAL_ON);
+
+  // 0 disables the timeout
+  SM noTimeout(clockNow);
+  noTimeout.setPortalTimeout(0);
+  noTimeout.portalStarted(false);
+  now += 0x7FFFFFFFUL;
+  CHECK(!(noTimeout.poll(true) & SM::ACT_STOP_AP));
+}
+
+static void testTraceWrap()
+{
+  SM sm(clockNow);
+  now = 100;
+  CHECK_EQ(sm.traceCount(), 0);
+  sm.handle(SM::EV_BEGIN);
+  CHECK_EQ(sm.traceCount(), 1);
+  CHECK_EQ(sm.trace(0).from, SM::IDLE);
+  CHECK_EQ(sm.trace(0).to, SM::CONNECTING);
+  CHECK_EQ(sm.trace(0).event, SM::EV_BEGIN);
+  // ignored events are not recorded
+  sm.handle(SM::EV_PORTAL_TIMEOUT);
+  CHECK_EQ(sm.traceCount(), 1);
+  // each round records disconnected and retry, the reason is the round
+  const int rounds = EWC_WIFI_TRACE_SIZE * 2 + 3;
+  for (int i = 0; i < rounds; i++)
+  {
+    now += 10;
+    sm.handle(SM::EV_DISCONNECTED, (uint8_t)i);
+    now += 10;
+    sm.handle(SM::EV_RETRY);
+  }
+  CHECK_EQ(sm.traceCount(), EWC_WIFI_TRACE_SIZE);
+  // the newest transition is the last retry, the oldest is EWC_WIFI_TRACE_SIZE transitions before
+  const SM::Transition &newest = sm.trace(EWC_WIFI_TRACE_SIZE - 1);
+  CHECK_EQ(newest.event, SM::EV_RETRY);
+  CHECK_EQ(newest.ts, now);
+  const SM::Transition &oldest = sm.trace(0);
+  CHECK_EQ(oldest.ts, now - (EWC_WIFI_TRACE_SIZE - 1) * 10);
+  for (uint8_t i = 1; i < EWC_WIFI_TRACE_SIZE; i++)
+  {
+    CHECK_EQ(sm.trace(i).ts, sm.trace(i - 1).ts + 10);
+    if (sm.trace(i).event == SM::EV_DISCONNECTED)
+    {
+      CHECK_EQ(sm.trace(i).from, SM::CONNECTING);
+      CHECK_EQ(sm.trace(i).to, SM::BACKOFF);
+    }
+  }
+  CHECK_EQ(sm.trace(EWC_WIFI_TRACE_SIZE - 2).reason, rounds - 1);
+}
+
+int main()
+{
+  testBackoff();
+  testJitter();
+  testRollover();
+  testPortalTimeout();
+  testTraceWrap();
+  return hostCheckResult("wifi_state_machine");
+}
@@ -4,6 +4,7 @@ from jsmin import jsmin as jsminify
 from htmlmin import minify as htmlminify
 from csscompressor import compress as cssminify
 import gzip
+import hashlib
 import sys
 import os.path
 import argparse
@@ -14,7 +15,50 @@ TARGET_TEMPLATE = '''const char {constant}[] PROGMEM = R"=====(
 {minidata}
 )=====";
 '''
+TARGET_ETAG_TEMPLATE = '''const char {constant}_ETAG[] PROGMEM = "\\"{etag}\\"";
+'''
 TARGET_GZIP_TEMPLATE = '''const uint8_t {constant}_GZIP[{gziplen}] PROGMEM = {{ {gzipdata} }};'''
+MANIFEST_HEADER_TEMPLATE = '''#pragma once
+#include <ewcAssetManifest.h>
+
+namespace EWC
+{{
+  extern AssetTable {table};
+}};
+'''
+MANIFEST_SOURCE_TEMPLATE = '''#include "{header}"
+{includes}
+
+namespace EWC
+{{
+{paths}
+
+  static const AssetEntry ASSET_ENTRIES[{count}] PROGMEM = {{
+{entries}
+  }};
+
+  static uint8_t ASSET_FLAGS[{count}] = {{ {flags} }};
+
+  AssetTable {table} = {{ASSET_ENTRIES, ASSET_FLAGS, {count}}};
+}};
+'''
+# MIME index as defined in ewcAssetManifest.h
+MANIFEST_MIME = {
+    'html': 'ASSET_MIME_HTML',
+    'css': 'ASSET_MIME_CSS',
+    'js': 'ASSET_MIME_JS',
+    'json': 'ASSET_MIME_JSON',
+    'svg': 'ASSET_MIME_SVG'
+}
+# static files are served by default, pages and JSON files have to be enabled by the sketch
+MANIFEST_ENABLED = ('css', 'js', 'svg')
+# pages of the optional library extensions get an own manifest, registered by the setup() of the extension,
+# so the pages of not used extensions are not linked: uri prefix -> name of the manifest
+LIBRARY_EXTENSIONS = {
+    '/mail/': 'Mail',
+    '/mqtt/': 'Mqtt',
+    '/ewc/update': 'Update'
+}
 
 
 def parse_arguments(args=None):
@@ -59,6 +103,12 @@ def get_context(infile, outfile):
     return locals()
 
 
+def perform_hash(c):
+    # the hash is built from the uncompressed data, since gzip output is not reproducible (until v3.8)
+    c['etag'] = hashlib.sha1(c['minidata'].encode('utf-8')).hexdigest()[:16]
+    return c
+
+
 def perform_gzip(c):
     compressed = gzip.compress(c['minidata'].encode('utf-8'), compresslevel=8)
     c['gzipdata'] = ','.join([ str(b) for b in compressed ])
@@ -80,13 +130,15 @@ def perform_minify(c, notminify=False):
         else:
             print('  Minify %s' % (c['infile']))
             c['minidata'] = minifier(infile.read())
+        perform_hash(c)
         perform_gzip(c)
     return c
 
 
-def process_file(infile, outdir, storemini=False, notminify=False):
+def process_file(infile, outdir, storemini=False, notminify=False, uri=None):
     print('Processing file %s' % infile)
     c = get_context(infile, outdir)
+    c['uri'] = uri
     c = perform_minify(c, notminify=notminify)
     if storemini:
         if c['infile'] == c['minifile']:
@@ -95,20 +147,17 @@ def process_file(infile, outdir, storemini=False, notminify=False):
             print('  Writing minified file %s' % c['minifile'])
             with open(c['minifile'], 'w+') as minifile:
                 minifile.write(c['minidata'])
-    template = TARGET_TEMPLATE.format(**c)
+    template = TARGET_TEMPLATE.format(**c) + TARGET_ETAG_TEMPLATE.format(**c)
     changed = True
     if os.path.exists(c['outfile']):
         # check for changes
         with open(c['outfile'], 'r') as outfile:
-            # since gzip returns not reproducible output (until v3.8) we need to extract no compressed part
+            # since gzip returns not reproducible output (until v3.8) we compare only the not compressed part
             current = outfile.read()
-            idx = current.find(')=====";\n')
-            if idx > 0:
-                found_part = current[0:idx+9]
-                changed = not (template == found_part)
+            changed = not current.startswith(template)
     if changed:
         with open(c['outfile'], 'w+') as outfile:
-            print('  Using C constant names %s and %s_GZIP' % (c['constant'], c['constant']))
+            print('  Using C constant names %s, %s_ETAG and %s_GZIP' % (c['constant'], c['constant'], c['constant']))
             print('  Writing C header file %s' % c['outfile'])
             print('  Data length:      %s' % len(c['minidata']))
             print('  GZIP data length: %s' % c['gziplen'])
@@ -117,7 +166,36 @@ def process_file(infile, outdir, storemini=False, notminify=False):
             outfile.write(TARGET_GZIP_TEMPLATE.format(**c))
     else:
         print('  no changes, skip')
-    return c['outfile']
+    return c
+
+
+def write_if_changed(filename, content):
+    if os.path.exists(filename):
+        with open(filename, 'r') as current:
+            if current.read() == content:
+                return
+    print('Writing asset manifest %s' % filename)
+    with open(filename, 'w+') as outfile:
+        outfile.write(content)
+
+
+def write_manifest(contexts, outdir, prefix, table):
+    """ Writes the table of all generated files sorted by uri, used by ConfigServer to serve the assets.
+        The uri is looked up case insensitive (strcasecmp_P), so the order ignores the case of ASCII letters. """
+    contexts = sorted(contexts, key=lambda c: c['uri'].encode('utf-8').lower())
+    header = '%sAssets.h' % prefix
+    includes, paths, entries, flags = [], [], [], []
+    for i, c in enumerate(contexts):
+        includes.append('#include "%s"' % c['outfilename'])
+        paths.append('  static const char ASSET_PATH_%d[] PROGMEM = "%s";' % (i, c['uri']))
+        entries.append('    {ASSET_PATH_%d, %s, %s_GZIP, sizeof(%s_GZIP), %s_ETAG},' % (i, MANIFEST_MIME.get(c['ext'], 'ASSET_MIME_HTML'), c['constant'], c['constant'], c['constant']))
+        flags.append('1' if c['ext'] in MANIFEST_ENABLED else '0')
+    hfile = os.path.join(outdir, header)
+    cppfile = os.path.join(outdir, '%sAssets.cpp' % prefix)
+    write_if_changed(hfile, MANIFEST_HEADER_TEMPLATE.format(table=table))
+    write_if_changed(cppfile, MANIFEST_SOURCE_TEMPLATE.format(header=header, includes='\n'.join(includes), paths='\n'.join(paths),
+                                                              entries='\n'.join(entries), flags=', '.join(flags), count=len(contexts), table=table))
+    return [hfile, cppfile]
   
         
 def process_dir(sourcedir, outdir, recursive=True, storemini=True, notminify=False):
@@ -133,23 +211,35 @@ def process_dir(sourcedir, outdir, recursive=True, storemini=True, notminify=Fal
                         files_filtered.add(f)
         except Exception:
             pass
-    result = []  # list with all generated files
+    result = []  # list with context of all generated files
     for f in files_filtered:
         if not '.min.' in f:
-            gf = process_file(f, outdir, storemini, notminify)
-            result.append(gf)
+            uri = '/' + os.path.relpath(os.path.realpath(f), os.path.realpath(sourcedir)).replace(os.path.sep, '/')
+            c = process_file(f, outdir, storemini, notminify, uri)
+            result.append(c)
         # elif not os.path.isfile(f.replace('.min.', '.')):
         #     process_file(f, outdir, storemini)
     return result
 
 
-def main(project_dir, storemini=False, notminify=False):
+def main(project_dir, storemini=False, notminify=False, is_library=False):
     pdir = project_dir
     web = os.path.realpath(os.path.join(pdir, 'web'))
     src  = os.path.realpath(os.path.join(pdir, 'src', 'generated'))
     os.makedirs(src, exist_ok=True)
     files = glob(src + '/**/*', recursive=True)
-    gf = process_dir(web, src, recursive = True, storemini=storemini, notminify=notminify)
+    contexts = process_dir(web, src, recursive = True, storemini=storemini, notminify=notminify)
+    gf = [c['outfile'] for c in contexts]
+    # JSON files of the library are sample data for local testing of the pages, they are not served
+    assets = [c for c in contexts if not (is_library and c['ext'] == 'json')]
+    if is_library:
+        for prefix, name in LIBRARY_EXTENSIONS.items():
+            extension = [c for c in assets if c['uri'].startswith(prefix)]
+            assets = [c for c in assets if not c['uri'].startswith(prefix)]
+            if extension:
+                gf += write_manifest(extension, src, 'ewc%s' % name, 'EWC_%s_ASSETS' % name.upper())
+    if assets:
+        gf += write_manifest(assets, src, 'ewc' if is_library else 'app', 'EWC_ASSETS' if is_library else 'APP_ASSETS')
     # remove old files
     for rmf in list(set(files) - set(gf)):
         print('Delete header of removed web file: %s' % rmf)
@@ -164,6 +254,6 @@ if __name__ == '__main__' and 'get_ipython' not in dir():
     library_dir = os.path.abspath(os.path.join(os.path.dirname(os.path.realpath(__file__)), '..'))
     if args.project_dir != library_dir:
 	    # generate library headers
-        main(library_dir, args.storemini, args.notminify)
-    main(args.project_dir, args.storemini, args.notminify)
+        main(library_dir, args.storemini, args.notminify, is_library=True)
+    main(args.project_dir, args.storemini, args.notminify, is_library=os.path.realpath(args.project_dir) == library_dir)
 
@@ -0,0 +1,64 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_ASSET_MANIFEST_H
+#define EWC_ASSET_MANIFEST_H
+
+#include <Arduino.h>
+
+namespace EWC
+{
+  /** MIME type index of an asset, see ConfigServer for the content type strings. **/
+  typedef enum
+  {
+    ASSET_MIME_HTML = 0,
+    ASSET_MIME_CSS,
+    ASSET_MIME_JS,
+    ASSET_MIME_JSON,
+    ASSET_MIME_SVG
+  } asset_mime_t;
+
+  /** Flags of an asset. **/
+  typedef enum
+  {
+    ASSET_ENABLED = 1, //< the asset is served by the ConfigServer
+    ASSET_NO_AUTH = 2  //< the asset is served without authentication
+  } asset_flags_t;
+
+  /** One gzip compressed web file. The entries are generated by scripts/generate_headers.py and stored in PROGMEM. **/
+  struct AssetEntry
+  {
+    PGM_P path;
+    uint8_t mime;
+    const uint8_t *gzip;
+    uint32_t len;
+    PGM_P etag;
+  };
+
+  /** Manifest with all generated web files of a project, sorted by path ignoring the case of ASCII letters.
+   * The flags are kept in RAM, one byte for each entry. **/
+  struct AssetTable
+  {
+    const AssetEntry *entries;
+    uint8_t *flags;
+    size_t count;
+  };
+};
+#endif
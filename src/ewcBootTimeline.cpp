@@ -0,0 +1,188 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#include "ewcBootTimeline.h"
+#include "ewcInterface.h"
+
+using namespace EWC;
+
+#if EWC_BOOT_HISTORY > 0
+/** Marks valid content, RTC memory is random after power on. Change on modification of Record. **/
+#define BOOT_HISTORY_MAGIC (0x45574232UL ^ EWC_BOOT_HISTORY)
+
+struct BootHistoryRtc
+{
+  uint32_t magic;
+  uint8_t next;
+  uint8_t count;
+  uint8_t reserved[2];
+  BootTimeline::Record records[EWC_BOOT_HISTORY];
+};
+
+#if defined(ESP8266)
+static_assert(EWC_BOOT_RTC_OFFSET * 4 + sizeof(BootHistoryRtc) <= 512, "EWC_BOOT_HISTORY does not fit into the RTC user memory");
+#elif defined(ESP32)
+RTC_NOINIT_ATTR static BootHistoryRtc rtcBootHistory;
+#endif
+#endif
+
+BootTimeline::BootTimeline()
+    : _count(0),
+      _setupUs(0),
+      _connectedUs(0)
+#if EWC_BOOT_HISTORY > 0
+      ,
+      _historyNext(0),
+      _historyCount(0),
+      _historyLoaded(false)
+#endif
+{
+}
+
+BootTimeline::Mark *BootTimeline::_next()
+{
+  if (finished() || _count >= EWC_BOOT_MARKS)
+  {
+    return nullptr;
+  }
+  Mark *mark = &_marks[_count++];
+  mark->us = micros();
+  return mark;
+}
+
+void BootTimeline::mark(const __FlashStringHelper *name)
+{
+  Mark *mark = _next();
+  if (mark)
+  {
+    strncpy_P(mark->name, reinterpret_cast<PGM_P>(name), EWC_BOOT_NAME_SIZE - 1);
+    mark->name[EWC_BOOT_NAME_SIZE - 1] = '\0';
+  }
+}
+
+void BootTimeline::mark(const String &name)
+{
+  Mark *mark = _next();
+  if (mark)
+  {
+    strncpy(mark->name, name.c_str(), EWC_BOOT_NAME_SIZE - 1);
+    mark->name[EWC_BOOT_NAME_SIZE - 1] = '\0';
+  }
+}
+
+void BootTimeline::setupDone()
+{
+  mark(F("setup"));
+  _setupUs = micros();
+}
+
+void BootTimeline::connected(const String &version)
+{
+  if (finished())
+  {
+    return;
+  }
+  mark(F("connected"));
+  _connectedUs = micros();
+  I::get().logger() << F("[EWC Boot]: setup ") << _setupUs << F(" us, connected after ") << _connectedUs << F(" us") << endl;
+#if EWC_BOOT_HISTORY > 0
+  _loadHistory();
+  Record &record = _history[_historyNext];
+  strncpy(record.version, version.c_str(), EWC_BOOT_NAME_SIZE - 1);
+  record.version[EWC_BOOT_NAME_SIZE - 1] = '\0';
+  record.setupUs = _setupUs;
+  record.connectedUs = _connectedUs;
+  _historyNext = (_historyNext + 1) % EWC_BOOT_HISTORY;
+  if (_historyCount < EWC_BOOT_HISTORY)
+  {
+    _historyCount++;
+  }
+  _saveHistory();
+#endif
+}
+
+void BootTimeline::fillJson(JsonDocument &jsonDoc)
+{
+  jsonDoc["setup_us"] = _setupUs;
+  jsonDoc["connected_us"] = _connectedUs;
+  JsonArray marks = jsonDoc["marks"].to<JsonArray>();
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    JsonObject mark = marks.add<JsonObject>();
+    mark["name"] = (const char *)_marks[i].name;
+    mark["us"] = _marks[i].us;
+    mark["dt_us"] = duration(i);
+  }
+  JsonArray history = jsonDoc["history"].to<JsonArray>();
+#if EWC_BOOT_HISTORY > 0
+  _loadHistory();
+  // newest boot first
+  for (uint8_t i = 1; i <= _historyCount; i++)
+  {
+    const Record &record = _history[(_historyNext + EWC_BOOT_HISTORY - i) % EWC_BOOT_HISTORY];
+    JsonObject entry = history.add<JsonObject>();
+    entry["version"] = (const char *)record.version;
+    entry["setup_us"] = record.setupUs;
+    entry["connected_us"] = record.connectedUs;
+  }
+#endif
+}
+
+#if EWC_BOOT_HISTORY > 0
+void BootTimeline::_loadHistory()
+{
+  if (_historyLoaded)
+  {
+    return;
+  }
+  _historyLoaded = true;
+  BootHistoryRtc data;
+#if defined(ESP8266)
+  if (!ESP.rtcUserMemoryRead(EWC_BOOT_RTC_OFFSET, reinterpret_cast<uint32_t *>(&data), sizeof(data)))
+  {
+    return;
+  }
+#elif defined(ESP32)
+  data = rtcBootHistory;
+#else
+  return;
+#endif
+  if (data.magic == BOOT_HISTORY_MAGIC && data.next < EWC_BOOT_HISTORY && data.count <= EWC_BOOT_HISTORY)
+  {
+    _historyNext = data.next;
+    _historyCount = data.count;
+    memcpy(_history, data.records, sizeof(_history));
+  }
+}
+
+void BootTimeline::_saveHistory()
+{
+  BootHistoryRtc data;
+  data.magic = BOOT_HISTORY_MAGIC;
+  data.next = _historyNext;
+  data.count = _historyCount;
+  memcpy(data.records, _history, sizeof(_history));
+#if defined(ESP8266)
+  ESP.rtcUserMemoryWrite(EWC_BOOT_RTC_OFFSET, reinterpret_cast<uint32_t *>(&data), sizeof(data));
+#elif defined(ESP32)
+  rtcBootHistory = data;
+#endif
+}
+#endif
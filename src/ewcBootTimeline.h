@@ -0,0 +1,100 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_BOOT_TIMELINE_H
+#define EWC_BOOT_TIMELINE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "ewcResetDetector.h"
+
+/** Maximal count of marks recorded in one boot, further marks are ignored. **/
+#ifndef EWC_BOOT_MARKS
+#define EWC_BOOT_MARKS 20
+#endif
+/** Count of boots kept in the history in RTC memory, 0 (default) disables the history. **/
+#ifndef EWC_BOOT_HISTORY
+#define EWC_BOOT_HISTORY 0
+#endif
+/** Offset in 4 byte blocks of the history in the RTC user memory of ESP8266, behind the counter of the ResetDetector. **/
+#ifndef EWC_BOOT_RTC_OFFSET
+#define EWC_BOOT_RTC_OFFSET (EWC_RESET_RTC_OFFSET + 2)
+#endif
+/** Maximal length of a mark name and the firmware version in the history, including the terminating zero. **/
+#define EWC_BOOT_NAME_SIZE 16
+
+namespace EWC
+{
+  /** Records the end of each boot phase with micros() since power on.
+   * When WiFi is connected the first time, the boot is finished. With EWC_BOOT_HISTORY > 0 a summary is
+   * stored in a ring of the last boots in RTC memory: it survives resets and deep sleep without a flash write
+   * on each boot and is cleared on power loss. Available on /ewc/boot.json. **/
+  class BootTimeline
+  {
+  public:
+    struct Mark
+    {
+      char name[EWC_BOOT_NAME_SIZE];
+      uint32_t us;
+    };
+    struct Record
+    {
+      char version[EWC_BOOT_NAME_SIZE];
+      uint32_t setupUs;
+      uint32_t connectedUs;
+    };
+
+    BootTimeline();
+    /** Marks the end of a phase. Ignored after the boot is finished. **/
+    void mark(const __FlashStringHelper *name);
+    void mark(const String &name);
+    /** Called at the end of ConfigServer::setup(). **/
+    void setupDone();
+    /** Called on first connect to WiFi: finishes the boot and appends it to the history. **/
+    void connected(const String &version);
+    bool finished() const { return _connectedUs != 0; }
+    uint32_t setupUs() const { return _setupUs; }
+    uint32_t connectedUs() const { return _connectedUs; }
+    uint8_t count() const { return _count; }
+    const Mark &at(uint8_t index) const { return _marks[index]; }
+    /** Duration of the phase ended by the mark at index. **/
+    uint32_t duration(uint8_t index) const { return index == 0 ? _marks[0].us : _marks[index].us - _marks[index - 1].us; }
+    /** Fills marks of current boot and the history. **/
+    void fillJson(JsonDocument &jsonDoc);
+
+  protected:
+    Mark _marks[EWC_BOOT_MARKS];
+    uint8_t _count;
+    uint32_t _setupUs;
+    uint32_t _connectedUs;
+#if EWC_BOOT_HISTORY > 0
+    Record _history[EWC_BOOT_HISTORY];
+    uint8_t _historyNext;
+    uint8_t _historyCount;
+    bool _historyLoaded;
+
+    /** Reads the ring from RTC memory once, an invalid content (e.g. after power on) starts an empty ring. **/
+    void _loadHistory();
+    void _saveHistory();
+#endif
+    Mark *_next();
+  };
+};
+#endif
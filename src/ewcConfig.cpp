@@ -26,6 +26,39 @@ limitations under the License.
 
 using namespace EWC;
 
+static bool _validNonEmpty(const char *value)
+{
+  return value != nullptr && value[0] != '\0';
+}
+
+/** The AP password is empty (open AP) or a WPA2 passphrase of 8 to 63 characters. **/
+static bool _validAPPass(const char *value)
+{
+  size_t len = value != nullptr ? strlen(value) : 0;
+  if (len == 0 || (len >= 8 && len <= 63))
+  {
+    return true;
+  }
+  // fail passphrase to short or long!
+  I::get().logger() << F("✘ [EWC Config]: Invalid AccessPoint password. Ignoring") << endl;
+  return false;
+}
+
+/** The device, AP and host names default to a name with the chip id, set by _initParams(). **/
+const Param<Config> Config::PARAM_LIST[] = {
+    paramBool<Config>("wifi_disabled", &Config::paramWifiDisabled, false, 0),
+    paramString<Config>("dev_name", &Config::paramDeviceName, nullptr, PARAM_FORM_NON_EMPTY, nullptr, _validNonEmpty),
+    paramBool<Config>("enable_serial_log_disabled", &Config::disableLogSetting, false, 0),
+    paramString<Config>("apName", &Config::paramAPName, nullptr, PARAM_FORM_NON_EMPTY, nullptr, _validNonEmpty),
+    paramString<Config>("apPass", &Config::_paramAPPass, "", PARAM_SECRET, nullptr, _validAPPass),
+    paramBool<Config>("ap_start_always", &Config::paramAPStartAlways, false),
+    paramBool<Config>("basic_auth", &Config::paramBasicAuth, false),
+    paramString<Config>("httpUser", &Config::paramHttpUser, DEFAULT_HTTP_USER),
+    paramString<Config>("httpPass", &Config::paramHttpPassword, DEFAULT_HTTP_PASSWORD, PARAM_SECRET),
+    paramString<Config>("hostname", &Config::paramHostname, nullptr, PARAM_FORM_NON_EMPTY, nullptr, _validNonEmpty),
+};
+const ParamTable<Config> Config::PARAMS(Config::PARAM_LIST);
+
 Config::Config() : ConfigInterface("ewc")
 {
   _bootMode = BootMode::CONFIGURATION;
@@ -87,88 +120,83 @@ void Config::setup(JsonDocument &config, bool resetConfig)
 
 void Config::fillJson(JsonDocument &config)
 {
-  config["ewc"]["enable_serial_log"] = I::get().logger().enabled();
-  config["ewc"]["enable_serial_log_disabled"] = disableLogSetting;
-  config["ewc"]["dev_name"] = paramDeviceName;
-  config["ewc"]["apName"] = paramAPName;
-  config["ewc"]["apPass"] = _paramAPPass;
-  config["ewc"]["ap_start_always"] = paramAPStartAlways;
-  config["ewc"]["wifi_disabled"] = paramWifiDisabled;
-  config["ewc"]["basic_auth"] = paramBasicAuth;
-  config["ewc"]["httpUser"] = paramHttpUser;
-  config["ewc"]["httpPass"] = paramHttpPassword;
-  config["ewc"]["hostname"] = paramHostname;
+  fillJson(config, true);
 }
 
-void Config::_fromJson(JsonDocument &doc)
+void Config::fillJson(JsonDocument &config, bool secrets)
 {
-  JsonVariant jv = doc["ewc"]["wifi_disabled"];
-  if (!jv.isNull())
+  JsonObject json = config["ewc"].to<JsonObject>();
+  PARAMS.toJson(*this, json, secrets);
+  json["enable_serial_log"] = I::get().logger().enabled();
+  json["sta_ip"] = paramStaIP ? paramStaIP.toString() : "";
+  json["sta_gw"] = paramStaGateway ? paramStaGateway.toString() : "";
+  json["sta_sn"] = paramStaNetmask ? paramStaNetmask.toString() : "";
+  json["sta_dns1"] = paramStaDns1 ? paramStaDns1.toString() : "";
+  json["sta_dns2"] = paramStaDns2 ? paramStaDns2.toString() : "";
+  paramNetworks.toJson(json["networks"].to<JsonArray>());
+  if (!secrets)
   {
-    paramWifiDisabled = jv.as<bool>();
-  }
-  jv = doc["ewc"]["dev_name"];
-  if (!jv.isNull())
-  {
-    String value = jv.as<String>();
-    if (!value.isEmpty())
+    for (JsonObject network : json["networks"].as<JsonArray>())
     {
-      paramDeviceName = value;
+      network.remove("pass");
     }
   }
-  jv = doc["ewc"]["enable_serial_log"];
-  if (!jv.isNull())
+}
+
+void Config::fromForm(WebServer *request)
+{
+  String apPass = _paramAPPass;
+  JsonDocument config;
+  PARAMS.fromForm(request, config["ewc"].to<JsonObject>());
+  _fromJson(config);
+  if (!_paramAPPass.equals(apPass))
   {
-    I::get().logger().setLogging(jv.as<bool>());
+    if (_paramAPPass.isEmpty())
+    {
+      I::get().logger() << F("[EWC Config]: Clear AccessPoint password") << endl;
+    }
+    else
+    {
+      I::get().logger() << F("[EWC Config]: Set new AccessPoint password") << endl;
+    }
   }
-  jv = doc["ewc"]["enable_serial_log_disabled"];
-  if (!jv.isNull())
+}
+
+void Config::removeSecrets(JsonDocument &config)
+{
+  PARAMS.removeSecrets(config["ewc"]);
+  for (JsonObject network : config["ewc"]["networks"].as<JsonArray>())
   {
-    disableLogSetting = jv.as<bool>();
+    network.remove("pass");
   }
-  jv = doc["ewc"]["apName"];
+}
+
+void Config::_ipFromJson(JsonVariant jv, IPAddress &ip)
+{
   if (!jv.isNull())
   {
     String value = jv.as<String>();
-    if (!value.isEmpty())
+    if (value.isEmpty() || !ip.fromString(value))
     {
-      paramAPName = value;
+      ip = IPAddress((uint32_t)0);
     }
   }
-  jv = doc["ewc"]["apPass"];
-  if (!jv.isNull())
-  {
-    setAPPass(jv.as<String>());
-  }
-  jv = doc["ewc"]["ap_start_always"];
-  if (!jv.isNull())
-  {
-    paramAPStartAlways = jv.as<bool>();
-  }
-  jv = doc["ewc"]["basic_auth"];
-  if (!jv.isNull())
-  {
-    paramBasicAuth = jv.as<bool>();
-  }
-  jv = doc["ewc"]["httpUser"];
-  if (!jv.isNull())
-  {
-    paramHttpUser = jv.as<String>();
-  }
-  jv = doc["ewc"]["httpPass"];
-  if (!jv.isNull())
-  {
-    paramHttpPassword = jv.as<String>();
-  }
-  jv = doc["ewc"]["hostname"];
+}
+
+void Config::_fromJson(JsonDocument &doc)
+{
+  PARAMS.fromJson(*this, doc["ewc"]);
+  JsonVariant jv = doc["ewc"]["enable_serial_log"];
   if (!jv.isNull())
   {
-    String value = jv.as<String>();
-    if (!value.isEmpty())
-    {
-      paramHostname = value;
-    }
+    I::get().logger().setLogging(jv.as<bool>());
   }
+  _ipFromJson(doc["ewc"]["sta_ip"], paramStaIP);
+  _ipFromJson(doc["ewc"]["sta_gw"], paramStaGateway);
+  _ipFromJson(doc["ewc"]["sta_sn"], paramStaNetmask);
+  _ipFromJson(doc["ewc"]["sta_dns1"], paramStaDns1);
+  _ipFromJson(doc["ewc"]["sta_dns2"], paramStaDns2);
+  paramNetworks.fromJson(doc["ewc"]["networks"]);
 }
 
 // ConfigInterface* Config::sub_config(String name) {
@@ -192,15 +220,10 @@ void Config::setAPPass(String pass)
 {
   if (!pass.isEmpty())
   {
-    if (pass.length() < 8 || pass.length() > 63)
-    {
-      // fail passphrase to short or long!
-      I::get().logger() << F("✘ [EWC Config]: Invalid AccessPoint password. Ignoring") << endl;
-    }
-    else
+    if (_validAPPass(pass.c_str()))
     {
       _paramAPPass = pass;
-      I::get().logger() << F("[EWC Config]: Set new AccessPoint password to ") << _paramAPPass << endl;
+      I::get().logger() << F("[EWC Config]: Set new AccessPoint password") << endl;
     }
   }
   else
@@ -212,16 +235,17 @@ void Config::setAPPass(String pass)
 
 void Config::_initParams()
 {
+  PARAMS.init(*this);
   paramDeviceName = String("ewc-") + getChipId();
-  paramAPName = String("ewc-") + getChipId();
-  _paramAPPass = "";
-  paramAPStartAlways = false;
-  paramWifiDisabled = false;
-  paramBasicAuth = false;
-  paramHttpUser = DEFAULT_HTTP_USER;
-  paramHttpPassword = DEFAULT_HTTP_PASSWORD;
+  paramAPName = paramDeviceName;
   paramHostname = paramAPName;
   paramLanguage = "en";
+  paramStaIP = IPAddress((uint32_t)0);
+  paramStaGateway = IPAddress((uint32_t)0);
+  paramStaNetmask = IPAddress((uint32_t)0);
+  paramStaDns1 = IPAddress((uint32_t)0);
+  paramStaDns2 = IPAddress((uint32_t)0);
+  paramNetworks.clear();
 }
 
 String Config::getChipId()
@@ -23,7 +23,10 @@ limitations under the License.
 #define EWC_CONFIG_h
 
 #include <Arduino.h>
+#include <IPAddress.h>
 #include "ewcConfigInterface.h"
+#include "ewcWiFiNetworks.h"
+#include "ewcParam.h"
 
 namespace EWC
 {
@@ -31,7 +34,6 @@ namespace EWC
   const char VERSION[] PROGMEM = "0.1.0";
   const char DEFAULT_HTTP_USER[] = "admin";
   const char DEFAULT_HTTP_PASSWORD[] = "";
-  const unsigned long WIFI_SCAN_DELAY = 10000;
   const char BOOT_MODE_FILENAME[] PROGMEM = "/boot.mode";
 
   enum BootMode
@@ -50,6 +52,11 @@ namespace EWC
     /** === ConfigInterface Methods === **/
     void setup(JsonDocument &config, bool resetConfig = false);
     void fillJson(JsonDocument &config);
+    void removeSecrets(JsonDocument &config);
+    /** Fills the configuration, with secrets = false without the passwords, e.g. for the setup pages. **/
+    void fillJson(JsonDocument &config, bool secrets);
+    /** Applies the arguments of the access form, see ParamTable::fromForm(). **/
+    void fromForm(WebServer *request);
 
     /** === BOOT mode handling  === **/
     void setBootMode(BootMode mode, bool forceWrite = false);
@@ -68,16 +75,28 @@ namespace EWC
     String paramHttpPassword;
     String paramHostname;
     String paramLanguage;
+    /** Static IP configuration of the station, DHCP is used if paramStaIP is not set. **/
+    IPAddress paramStaIP;
+    IPAddress paramStaGateway;
+    IPAddress paramStaNetmask;
+    IPAddress paramStaDns1;
+    IPAddress paramStaDns2;
+    /** Known networks, if empty the network saved by the WiFi library is used. **/
+    WiFiNetworks paramNetworks;
     String getChipId();
     bool disableLogSetting = false;
 
   protected:
+    /** Plain parameter, the static IP, the known networks and the serial log setting are handled by _fromJson() and fillJson(). **/
+    static const Param<Config> PARAM_LIST[];
+    static const ParamTable<Config> PARAMS;
     BootMode _bootMode;
 
     String _paramAPPass;
 
     void _initParams();
     void _fromJson(JsonDocument &doc);
+    void _ipFromJson(JsonVariant jv, IPAddress &ip);
   };
 
 };
@@ -21,8 +21,12 @@ limitations under the License.
 #include <LittleFS.h>
 #include "ewcConfig.h"
 #include "ewcConfigFS.h"
+#include "ewcBootTimeline.h"
 #include "ewcLed.h"
 #include "ewcLogger.h"
+#include "ewcMetrics.h"
+#include "ewcProfiler.h"
+#include "ewcVersionTag.h"
 
 using namespace EWC;
 
@@ -71,10 +75,37 @@ void listDir(fs::FS &fs, const char *dirname, uint8_t levels)
 }
 #endif
 
+#ifdef EWC_CONFIG_JSON
+static const bool STORE_JSON = true;
+#else
+static const bool STORE_JSON = false;
+#endif
+
+/** Print target which hashes the serialized output without storing it. **/
+class HashPrint : public Print
+{
+public:
+  size_t write(uint8_t c) override
+  {
+    tag.add(&c, 1);
+    return 1;
+  }
+  size_t write(const uint8_t *buffer, size_t size) override
+  {
+    tag.add(buffer, size);
+    return size;
+  }
+  VersionTag tag;
+};
+
 ConfigFS::ConfigFS(String filename)
 {
   _filename = filename;
   _resetDetected = false;
+  _generation = 0;
+  _savePending = false;
+  _saveFirstTs = 0;
+  _saveLastTs = 0;
 }
 
 ConfigFS::~ConfigFS()
@@ -84,7 +115,6 @@ ConfigFS::~ConfigFS()
 
 void ConfigFS::setup()
 {
-  String resetFileName = RESET_FILENAME;
   I::get().logger() << F("[EWC ConfigFS]: setup config container") << endl;
   I::get().logger() << F("[EWC ConfigFS]: initialize LittleFS") << endl;
 #ifdef ESP8266
@@ -102,77 +132,87 @@ void ConfigFS::setup()
   //     I::get().logger() << "  found file: " << root.name() << endl;
   // }
 #endif
-  bool bootModeChanged = false;
-  String resetString;
-  File resetFile = LittleFS.open(resetFileName, "r");
-  if (resetFile && !resetFile.isDirectory())
-  {
-    I::get().logger() << F("[EWC ConfigFS]: file open: ") << resetFile.name() << endl;
-    resetString = resetFile.readString();
-    resetFile.close();
-    int resetCount = resetString.toInt();
-    I::get().logger() << F("\n[EWC ConfigFS]: resetString: ") << resetString << F(", resetCount: ") << resetCount << endl;
-    if (resetCount == 2)
-    {
-      I::get().logger() << F("\n[EWC ConfigFS]: change boot mode to configuration") << endl;
-      I::get().led().start(LED_ORANGE, 250, 125);
-      bootModeChanged = true;
-      I::get().config().setBootMode(BootMode::CONFIGURATION, true);
-    }
-    if (resetCount == 5)
-    {
-      I::get().logger() << F("\n[EWC ConfigFS]: RESET detected, remove configuration") << endl;
-      I::get().led().start(LED_RED, 250, 125);
-      _resetDetected = true;
-      // delete configuration file
-      LittleFS.remove(_filename);
-      delay(2000);
-    }
-    resetCount += 1;
-    I::get().logger() << F("[EWC ConfigFS]: update reset file with ") << String(resetCount)[0] << endl;
-    resetFile = LittleFS.open(resetFileName, "w");
-    resetFile.write(String(resetCount)[0]);
-    resetFile.close();
-    if (!bootModeChanged && !_resetDetected)
-    {
-      I::get().led().start(LED_GREEN, 2000, 2000);
-    }
-    I::get().logger() << F("[EWC ConfigFS]: wait for reset") << endl;
-    delay(2000);
+  I::get().boot().mark(F("fs.mount"));
+  uint8_t resetCount = _resetDetector.begin();
+  if (resetCount == 2)
+  {
+    I::get().logger() << F("[EWC ConfigFS]: change boot mode to configuration") << endl;
+    I::get().led().start(LED_ORANGE, 250, 125);
+    I::get().config().setBootMode(BootMode::CONFIGURATION, true);
+  }
+  else if (resetCount == 5)
+  {
+    I::get().logger() << F("[EWC ConfigFS]: RESET detected, remove configuration") << endl;
+    I::get().led().start(LED_RED, 250, 125);
+    _resetDetected = true;
+    // delete configuration file
+    LittleFS.remove(_filename);
+    LittleFS.remove(FPSTR(CONFIG_FILENAME));
   }
   else
   {
-    I::get().logger() << F("[EWC ConfigFS]: create reset file") << endl;
-    resetFile = LittleFS.open(resetFileName, "w");
-    resetFile.write('1');
-    resetFile.close();
-    I::get().led().start(LED_GREEN, 2000, 2000);
-    I::get().logger() << F("[EWC ConfigFS]: wait for reset") << endl;
-    delay(2000);
+    // signals the window for the next reset, cleared by loop()
+    I::get().led().start(LED_GREEN, EWC_RESET_WINDOW_MS, EWC_RESET_WINDOW_MS);
   }
-  I::get().logger() << F("[EWC ConfigFS]: delete reset file") << endl;
-  LittleFS.remove(resetFileName);
-
+  I::get().boot().mark(F("fs.reset"));
   I::get().logger() << F("[EWC ConfigFS]: Load configuration from ") << _filename << endl;
-  JsonDocument jsonDoc;
+  bool json = STORE_JSON;
+  bool migrate = false;
   File cfgFile = LittleFS.open(_filename, "r");
   if (cfgFile && !cfgFile.isDirectory())
   {
     I::get().logger() << F("[EWC ConfigFS]: file open: ") << cfgFile.name() << endl;
-    deserializeJson(jsonDoc, cfgFile);
   }
+  else if (!_filename.equals(FPSTR(CONFIG_FILENAME)) && LittleFS.exists(FPSTR(CONFIG_FILENAME)))
+  {
+    // configuration of a previous version
+    I::get().logger() << F("[EWC ConfigFS]: migrate configuration from ") << FPSTR(CONFIG_FILENAME) << endl;
+    cfgFile = LittleFS.open(FPSTR(CONFIG_FILENAME), "r");
+    json = true;
+    migrate = true;
+  }
+  I::get().boot().mark(F("fs.load"));
   // add sub configurations
   I::get().logger() << F("[EWC ConfigFS]: Load sub-configurations, count: ") << _cfgInterfaces.size() << endl;
   for (std::size_t i = 0; i < _cfgInterfaces.size(); ++i)
   {
     I::get().logger() << F("[EWC ConfigFS]:  load [") << i << F("]: ") << _cfgInterfaces[i]->name() << endl;
+    // each module gets only its own keys, so the peak memory is bounded by the largest module
+    JsonDocument jsonDoc;
+    if (cfgFile && !cfgFile.isDirectory())
+    {
+      JsonDocument filter;
+      _cfgInterfaces[i]->filter(filter);
+      cfgFile.seek(0);
+      if (_read(cfgFile, jsonDoc, json, &filter))
+      {
+        migrate = false;
+      }
+    }
     _cfgInterfaces[i]->setup(jsonDoc, false);
+    // a save without changes does not write the file
+    _hashes[i] = _hash(*_cfgInterfaces[i]);
+    I::get().boot().mark(_cfgInterfaces[i]->name());
     // _cfgInterfaces[i]->setup(jsonDoc, _resetDetected);
   }
+  if (cfgFile)
+  {
+    cfgFile.close();
+  }
+  if (migrate)
+  {
+    // the JSON file is kept unchanged, so a downgrade to a JSON version still finds the configuration
+    _write();
+  }
 }
 
 void ConfigFS::loop()
 {
+  _resetDetector.loop();
+  if (_savePending && (millis() - _saveLastTs >= EWC_CONFIG_SAVE_DELAY_MS || millis() - _saveFirstTs >= EWC_CONFIG_SAVE_MAX_DELAY_MS))
+  {
+    flush();
+  }
 }
 
 // ConfigInterface* Config::sub_config(String name) {
@@ -182,20 +222,140 @@ void ConfigFS::loop()
 // }
 
 void ConfigFS::save()
+{
+  for (std::size_t i = 0; i < _dirty.size(); ++i)
+  {
+    _dirty[i] = true;
+  }
+  _requestSave();
+}
+
+void ConfigFS::save(ConfigInterface &config)
+{
+  for (std::size_t i = 0; i < _cfgInterfaces.size(); ++i)
+  {
+    if (_cfgInterfaces[i] == &config)
+    {
+      _dirty[i] = true;
+    }
+  }
+  _requestSave();
+}
+
+void ConfigFS::_requestSave()
+{
+  // responses derived from the configuration are outdated at once, the file is written later
+  bumpGeneration();
+  if (!_savePending)
+  {
+    _savePending = true;
+    _saveFirstTs = millis();
+  }
+  _saveLastTs = millis();
+}
+
+void ConfigFS::flush()
+{
+  if (!_savePending)
+  {
+    return;
+  }
+  EWC_PROFILE_SCOPE("configfs.save");
+  _savePending = false;
+  bool changed = false;
+  for (std::size_t i = 0; i < _cfgInterfaces.size(); ++i)
+  {
+    if (!_dirty[i])
+    {
+      continue;
+    }
+    _dirty[i] = false;
+    uint32_t hash = _hash(*_cfgInterfaces[i]);
+    if (hash != _hashes[i])
+    {
+      I::get().logger() << F("[EWC ConfigFS]:  changed [") << i << F("]: ") << _cfgInterfaces[i]->name() << endl;
+      _hashes[i] = hash;
+      changed = true;
+    }
+  }
+  if (!changed)
+  {
+    I::get().logger() << F("[EWC ConfigFS]: configuration unchanged, skip write") << endl;
+    return;
+  }
+  _write();
+}
+
+void ConfigFS::_write()
 {
   I::get().logger() << F("[EWC ConfigFS]: save sub-configurations, count: ") << _cfgInterfaces.size() << endl;
+  I::get().metrics().configSaved();
   JsonDocument doc;
   for (std::size_t i = 0; i < _cfgInterfaces.size(); ++i)
   {
-    I::get().logger() << F("[EWC ConfigFS]:  add [") << i << F("]: ") << _cfgInterfaces[i]->name() << endl;
     _cfgInterfaces[i]->fillJson(doc);
   }
   // Open file for writing
   File file = LittleFS.open(_filename, "w");
+  if (!file)
+  {
+    I::get().logger() << F("✘ [EWC ConfigFS]: can not open ") << _filename << endl;
+    return;
+  }
+#ifdef EWC_CONFIG_JSON
   // Write a prettified JSON document to the file
   serializeJsonPretty(doc, file);
-  if (file)
-    file.close();
+#else
+  serializeMsgPack(doc, file);
+#endif
+  file.close();
+}
+
+DeserializationError ConfigFS::_read(File &file, JsonDocument &doc, bool json, JsonDocument *filter)
+{
+  DeserializationError error;
+  if (filter != nullptr)
+  {
+    error = json ? deserializeJson(doc, file, DeserializationOption::Filter(*filter)) : deserializeMsgPack(doc, file, DeserializationOption::Filter(*filter));
+  }
+  else
+  {
+    error = json ? deserializeJson(doc, file) : deserializeMsgPack(doc, file);
+  }
+  if (error)
+  {
+    I::get().logger() << F("✘ [EWC ConfigFS]: read ") << file.name() << F(" failed: ") << error.c_str() << endl;
+  }
+  return error;
+}
+
+bool ConfigFS::load(JsonDocument &doc, bool secrets)
+{
+  flush();
+  File file = LittleFS.open(_filename, "r");
+  if (!file || file.isDirectory())
+  {
+    return false;
+  }
+  bool result = !_read(file, doc, STORE_JSON);
+  file.close();
+  if (result && !secrets)
+  {
+    for (ConfigInterface *config : _cfgInterfaces)
+    {
+      config->removeSecrets(doc);
+    }
+  }
+  return result;
+}
+
+uint32_t ConfigFS::_hash(ConfigInterface &config)
+{
+  JsonDocument doc;
+  config.fillJson(doc);
+  HashPrint hashPrint;
+  serializeJson(doc, hashPrint);
+  return hashPrint.tag.value();
 }
 
 void ConfigFS::addConfig(ConfigInterface &config)
@@ -203,12 +363,22 @@ void ConfigFS::addConfig(ConfigInterface &config)
   // TODO: add check to avoid add a config twice
   I::get().logger() << F("[EWC ConfigFS]:  add: ") << config.name() << endl;
   _cfgInterfaces.push_back(&config);
+  _dirty.push_back(false);
+  _hashes.push_back(0);
 }
 
 void ConfigFS::deleteFile()
 {
   I::get().logger() << F("[EWC ConfigFS]: reset configuration file") << endl;
+  // a pending save would restore the file
+  _savePending = false;
+  for (std::size_t i = 0; i < _hashes.size(); ++i)
+  {
+    _dirty[i] = false;
+    _hashes[i] = 0;
+  }
   LittleFS.remove(_filename);
+  LittleFS.remove(FPSTR(CONFIG_FILENAME));
 }
 
 String ConfigFS::readFrom(String fileName)
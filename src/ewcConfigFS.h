@@ -29,39 +29,87 @@ https://github.com/datacute/DoubleResetDetector
 #define EWC_CONFIG_CONTAINER_h
 
 #include <Arduino.h>
+#include <FS.h>
 #ifdef ESP32
 #define USE_LittleFS
 #include <vector>
 #endif
 #include "ewcConfigInterface.h"
+#include "ewcResetDetector.h"
+
+/** The configuration file is written this time after the last save request. **/
+#ifndef EWC_CONFIG_SAVE_DELAY_MS
+#define EWC_CONFIG_SAVE_DELAY_MS 1000
+#endif
+/** Upper limit of the write delay while save requests continue. **/
+#ifndef EWC_CONFIG_SAVE_MAX_DELAY_MS
+#define EWC_CONFIG_SAVE_MAX_DELAY_MS 5000
+#endif
 
 namespace EWC
 {
 
-  const char RESET_FILENAME[] PROGMEM = "/reset.lock";
+  /** JSON configuration file, written pretty printed if EWC_CONFIG_JSON is defined.
+   * Otherwise it is only read to migrate to the MessagePack file and kept for a downgrade. **/
   const char CONFIG_FILENAME[] PROGMEM = "/ewc.json";
+  /** Compact binary configuration file, the default storage. **/
+  const char CONFIG_MSGPACK_FILENAME[] PROGMEM = "/ewc.mpk";
+#ifdef EWC_CONFIG_JSON
+#define EWC_CONFIG_STORE_FILENAME CONFIG_FILENAME
+#else
+#define EWC_CONFIG_STORE_FILENAME CONFIG_MSGPACK_FILENAME
+#endif
 
   class ConfigFS
   {
   public:
-    ConfigFS(String filename = FPSTR(CONFIG_FILENAME));
+    ConfigFS(String filename = FPSTR(EWC_CONFIG_STORE_FILENAME));
     ~ConfigFS();
 
     void setup();
+    /** Writes the pending save after the debounce window. **/
     void loop();
+    /** Marks all modules as changed. The file is written by loop() after EWC_CONFIG_SAVE_DELAY_MS,
+     * so a burst of save requests results in one write. **/
     void save();
+    /** Marks only the given module as changed. **/
+    void save(ConfigInterface &config);
+    /** Writes a pending save at once. Call before restart or firmware update. **/
+    void flush();
+    /** Reads the stored configuration into doc, a pending save is written before. Returns false if no configuration is stored.
+     * With secrets = false each module removes its secrets from doc. **/
+    bool load(JsonDocument &doc, bool secrets = true);
+    /** True if a save is waiting for the debounce window. **/
+    bool pending() const { return _savePending; }
     void deleteFile();
     /** === Configurations of modules implement ConfigInterface === **/
     void addConfig(ConfigInterface &config);
     // ConfigInterface* sub_config(String name);
     bool resetDetected() { return _resetDetected; }
+    /** Counter incremented on each save. Used to detect outdated responses derived from the configuration. **/
+    uint32_t generation() const { return _generation; }
+    void bumpGeneration() { _generation++; }
     String readFrom(String fileName);
     bool saveTo(String fileName, String data);
 
   protected:
     bool _resetDetected;
+    uint32_t _generation;
     String _filename;
     std::vector<ConfigInterface *> _cfgInterfaces;
+    std::vector<bool> _dirty;      //< per module: save requested since last write
+    std::vector<uint32_t> _hashes; //< per module: hash of the JSON written last or loaded
+    bool _savePending;
+    unsigned long _saveFirstTs;
+    unsigned long _saveLastTs;
+    ResetDetector _resetDetector;
+
+    void _requestSave();
+    /** Writes the configuration of all modules into the file. **/
+    void _write();
+    /** Reads the file as JSON or MessagePack, only the keys of the filter if given. **/
+    DeserializationError _read(File &file, JsonDocument &doc, bool json, JsonDocument *filter = nullptr);
+    static uint32_t _hash(ConfigInterface &config);
   };
 
 };
@@ -39,6 +39,11 @@ namespace EWC
     virtual void setup(JsonDocument &config, bool resetConfig = false) = 0;
     /** On configuration save the ConfigFS requests each ConfigInterface to fill the JSON object with parameter to save. **/
     virtual void fillJson(JsonDocument &config) = 0;
+    /** Sets the keys passed to setup() on load, all other keys of the file are skipped while parsing.
+     * By default the object with the name of this interface. Override if the module stores other keys. **/
+    virtual void filter(JsonDocument &filter) { filter[_name] = true; }
+    /** Removes passwords and other secrets from the JSON written by fillJson() before it is served to a client. **/
+    virtual void removeSecrets(JsonDocument &config) {}
 
     /** Name of this configuration interface. Currently only used to compare configuration interfaces. **/
     const String &name() { return _name; }
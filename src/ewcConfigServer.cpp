@@ -22,20 +22,16 @@ limitations under the License.
 #include "ewcConfigServer.h"
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include <algorithm>
 #include "ewcInterface.h"
-#include "generated/ewcInfoHTML.h"
-#include "generated/accessSetupHTML.h"
+#include "ewcRequestHandler.h"
+#include "ewcResponseWriter.h"
+#include "ewcTemplate.h"
+#include "ewcVersionTag.h"
+#include "ewcProfiler.h"
+#include "generated/ewcAssets.h"
 #include "generated/ewcFailHTML.h"
 #include "generated/ewcSuccessHTML.h"
-#include "generated/loggingSetupHTML.h"
-#include "generated/webBaseCSS.h"
-#include "generated/webPostloadJS.h"
-#include "generated/webPreJS.h"
-#include "generated/webTableCSS.h"
-#include "generated/webWifiiconsCSS.h"
-#include "generated/webWifiJS.h"
-#include "generated/wifiStateHTML.h"
-#include "generated/wifiSetupHTML.h"
 
 /**
  *  An actual reset function dependent on the architecture
@@ -69,6 +65,9 @@ PGM_P ConfigServer::wlStatusSymbols[] = {
     "DISCONNECTED",
     "NO_SHIELD"};
 
+/** Request headers we evaluate in addition to Authorization, see WebServer::collectHeaders(). */
+static const char *COLLECT_HEADERS[] = {"If-None-Match", "Cookie"};
+
 #if defined(ESP8266)
 WiFiEventHandler p1;
 WiFiEventHandler p2;
@@ -79,9 +78,47 @@ WiFiEventHandler p6;
 WiFiEventHandler p7;
 #endif
 
+/** Hardware random number for the jitter of the WiFi reconnect and the session tokens. **/
+static uint32_t _hwRandom()
+{
+#if defined(ESP8266)
+  return ESP.random();
+#else
+  return esp_random();
+#endif
+}
+
+/** Writes the string as quoted JSON string, used for request parameters echoed into a streamed response. **/
+static void _printJsonString(Print &out, const String &value)
+{
+  out.print('"');
+  for (size_t i = 0; i < value.length(); i++)
+  {
+    char c = value[i];
+    if (c == '"' || c == '\\')
+    {
+      out.print('\\');
+      out.print(c);
+    }
+    else if ((uint8_t)c < 0x20)
+    {
+      char escaped[7];
+      snprintf_P(escaped, sizeof(escaped), PSTR("\\u%04x"), (uint8_t)c);
+      out.print(escaped);
+    }
+    else
+    {
+      out.print(c);
+    }
+  }
+  out.print('"');
+}
+
 ConfigServer::ConfigServer(uint16_t port)
     : _server(port),
-      _brand("ESP Web Config")
+      _brand("ESP Web Config"),
+      _wifiState(millis, _hwRandom),
+      _sessions(_hwRandom)
 {
   I::get()._server = this;
   I::get()._config = &_config;
@@ -89,21 +126,27 @@ ConfigServer::ConfigServer(uint16_t port)
   I::get()._time = &_time;
   I::get()._logger = &_logger;
   I::get()._led = &_led;
+  I::get()._metrics = &_metrics;
+  I::get()._boot = &_bootTimeline;
   _publicConfig = true;
   _brandUri = "/";
-  _connected_wifi = false;
-  _ap_disabled_after_timeout = false;
   _disconnect_state = 0;
   _disconnect_reason = "";
   _softAPClientCount = 0;
   _configFS.addConfig(_config);
   _configFS.addConfig(_time);
+  addAssets(EWC_ASSETS);
+  _server.addHandler(new MetricsHandler());
+  _probeHandler = new ProbeHandler(*this);
+  _server.addHandler(_probeHandler);
+  _server.addHandler(new AssetHandler(*this));
 }
 
 void ConfigServer::setup()
 {
   I::get().logger() << F("[EWC CS]: setup configFS") << endl;
   _configFS.setup();
+  _bootTimeline.mark(F("configfs"));
   WiFi.setAutoConnect(false);
   if (_configFS.resetDetected())
   {
@@ -137,13 +180,22 @@ void ConfigServer::setup()
     {
       WiFi.mode(WIFI_AP_STA);
       _startAP();
+      _bootTimeline.mark(F("ap"));
     }
     else if (_config.getBootMode() != BootMode::STANDALONE)
     {
       WiFi.mode(WIFI_STA);
       delay(500);
+      _bootTimeline.mark(F("sta"));
     }
+    if (_wifiCacheEnabled)
+    {
+      _wifiCache.load();
+    }
+    _wifiState.handle(WiFiStateMachine::EV_BEGIN);
+    _startRound();
     _connect();
+    _bootTimeline.mark(F("connect"));
     _startWiFiScan();
   }
   else
@@ -151,39 +203,44 @@ void ConfigServer::setup()
     WiFi.mode(WIFI_OFF);
   }
 
-  I::get().logger() << "CSS_WEB_BASE_GZIP size: " << sizeof(CSS_WEB_BASE_GZIP) << endl;
+  // headers used for conditional requests
+  _server.collectHeaders(COLLECT_HEADERS, sizeof(COLLECT_HEADERS) / sizeof(COLLECT_HEADERS[0]));
   // _server.reset(); do we need this?
   /* Setup web pages: root, wifi config pages, SO captive portal detectors and not found. */
-  _server.on("/menu.json", std::bind(&ConfigServer::_sendMenu, this, &_server));
-  _server.on("/css/base.css", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_TEXT_CSS), CSS_WEB_BASE_GZIP, sizeof(CSS_WEB_BASE_GZIP)));
-  _server.on("/css/table.css", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_TEXT_CSS), CSS_WEB_TABLE_GZIP, sizeof(CSS_WEB_TABLE_GZIP)));
-  _server.on("/css/wifiicons.css", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_TEXT_CSS), CSS_WEB_WIFIICONS_GZIP, sizeof(CSS_WEB_WIFIICONS_GZIP)));
-  _server.on("/js/postload.js", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_APPLICATION_JS), JS_WEB_POSTLOAD_GZIP, sizeof(JS_WEB_POSTLOAD_GZIP)));
-  _server.on("/js/pre.js", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_APPLICATION_JS), JS_WEB_PRE_GZIP, sizeof(JS_WEB_PRE_GZIP)));
-  _server.on("/js/wifi.js", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_APPLICATION_JS), JS_WEB_WIFI_GZIP, sizeof(JS_WEB_WIFI_GZIP)));
-  insertMenuCb("WiFi", "/wifi/setup", "menu_wifi", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_WIFI_SETUP_GZIP, sizeof(HTML_WIFI_SETUP_GZIP)));
+  _server.on("/ewc/batch.json", std::bind(&ConfigServer::_onBatch, this, &_server));
+  _server.on("/ewc/metrics", std::bind(&ConfigServer::_onMetrics, this, &_server));
+#ifdef EWC_PROFILE
+  addJsonProducer("profile", "/ewc/profile.json", std::bind(&ConfigServer::_fillProfile, this, std::placeholders::_1));
+#endif
+  addJsonProducer("menu", "/menu.json", std::bind(&ConfigServer::_fillMenu, this, std::placeholders::_1), true);
+  insertMenuA("WiFi", "/wifi/setup", "menu_wifi");
   _server.on("/wifi/disconnect", std::bind(&ConfigServer::_onWiFiDisconnect, this, &_server)); //.setFilter(ON_AP_FILTER);
   _server.on("/wifi/config/save", std::bind(&ConfigServer::_onWiFiConnect, this, &_server));
-  _server.on("/wifi/state.html", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_WIFI_SETUP_GZIP, sizeof(HTML_WIFI_SETUP_GZIP)));
-  _server.on("/wifi/state.json", std::bind(&ConfigServer::_onWifiState, this, &_server));
-  _server.on("/wifi/stations.json", std::bind(&ConfigServer::_onWifiScan, this, &_server));
-  insertMenuCb("Access", "/access/setup", "menu_access", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_ACCESS_SETUP_GZIP, sizeof(HTML_ACCESS_SETUP_GZIP)));
-  _server.on("/access/config.json", std::bind(&ConfigServer::_onAccessGet, this, &_server));
+  _server.on("/wifi/network/remove", std::bind(&ConfigServer::_onWiFiNetworkRemove, this, &_server));
+  enableAsset("/wifi/state.html");
+  addJsonProducer("wifi_state", "/wifi/state.json", std::bind(&ConfigServer::_fillWifiState, this, std::placeholders::_1), false, std::bind(&ConfigServer::_wifiStateVersion, this));
+  addJsonProducer("wifi_stations", "/wifi/stations.json", std::bind(&ConfigServer::_fillWifiScan, this, std::placeholders::_1));
+  addJsonProducer("wifi_networks", "/wifi/networks.json", std::bind(&ConfigServer::_fillWifiNetworks, this, std::placeholders::_1));
+  addJsonProducer("wifi_trace", "/wifi/trace.json", std::bind(&ConfigServer::_fillWifiTrace, this, std::placeholders::_1));
+  insertMenuA("Access", "/access/setup", "menu_access");
+  addJsonProducer("access_config", "/access/config.json", std::bind(&ConfigServer::_fillAccess, this, std::placeholders::_1), true);
   _server.on("/access/config/save", std::bind(&ConfigServer::_onAccessSave, this, &_server));
-  insertMenuCb("Logging", "/logging/setup", "menu_access", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_LOGGING_SETUP_GZIP, sizeof(HTML_LOGGING_SETUP_GZIP)));
-  _server.on("/logging/config.json", std::bind(&ConfigServer::_onLoggingGet, this, &_server));
+  insertMenuA("Logging", "/logging/setup", "menu_access");
+  addJsonProducer("logging_config", "/logging/config.json", std::bind(&ConfigServer::_fillLogging, this, std::placeholders::_1), true);
   _server.on("/logging/enable", std::bind(&ConfigServer::_onLoggingEnable, this, &_server));
-  insertMenuCb("Info", "/ewc/info", "menu_info", std::bind(&ConfigServer::sendContentG, this, &_server, FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_EWC_INFO_GZIP, sizeof(HTML_EWC_INFO_GZIP)));
-  _server.on("/ewc/info.json", std::bind(&ConfigServer::_onGetInfo, this, &_server));
+  insertMenuA("Info", "/ewc/info", "menu_info");
+  addJsonProducer("info", "/ewc/info.json", std::bind(&ConfigServer::_fillInfo, this, std::placeholders::_1));
+  addJsonProducer("boot", "/ewc/boot.json", std::bind(&BootTimeline::fillJson, &_bootTimeline, std::placeholders::_1));
   if (_publicConfig)
   {
-    _server.on("/config.json", std::bind(&ConfigServer::_sendFileContent, this, &_server, FPSTR(PROGMEM_CONFIG_APPLICATION_JS), FPSTR(CONFIG_FILENAME)));
+    _server.on("/config.json", std::bind(&ConfigServer::_onConfigJson, this, &_server));
   }
   _server.on("/device/delete", std::bind(&ConfigServer::_onDeviceReset, this, &_server));
   _server.on("/device/restart", std::bind(&ConfigServer::_onDeviceRestart, this, &_server));
   _server.on("/favicon.ico", std::bind(&ConfigServer::_sendFileContent, this, &_server, "image/x-icon", "/favicon.ico"));
   _server.onNotFound(std::bind(&ConfigServer::_onNotFound, this, &_server));
   _server.begin(); // Web server start
+  _bootTimeline.setupDone();
 }
 
 void ConfigServer::_startAP()
@@ -191,7 +248,7 @@ void ConfigServer::_startAP()
   // Start LED with AP_STA
   _led.start(LED_GREEN_RED, 1000, 500);
   I::get().logger() << endl;
-  _msConfigPortalStart = _config.paramAPStartAlways ? 0 : millis();
+  _wifiState.portalStarted(_config.paramAPStartAlways);
   I::get().logger() << F("[EWC CS]: Configuring access point... ") << _config.paramAPName << endl;
   // optional soft ip config
   //  if (_ap_static_ip) {
@@ -221,11 +278,12 @@ void ConfigServer::_connect(const char *ssid, const char *pass)
   _msConnectStart = millis();
   _disconnect_state = 0;
   _disconnect_reason = "";
+  _fastConnect = false;
   // check if we've got static_ip settings, if we do, use those.
-  if (_sta_static_ip)
+  if (_config.paramStaIP)
   {
     I::get().logger() << F("[EWC CS]: Custom STA IP/GW/Subnet/DNS") << endl;
-    WiFi.config(_sta_static_ip, _sta_static_gw, _sta_static_sn, _sta_static_dns1, _sta_static_dns2);
+    WiFi.config(_config.paramStaIP, _config.paramStaGateway, _config.paramStaNetmask, _config.paramStaDns1, _config.paramStaDns2);
     I::get().logger() << F("[EWC CS]:   Local IP: ") << WiFi.localIP() << endl;
   }
   if (ssid != nullptr && strlen(ssid) > 0)
@@ -237,9 +295,34 @@ void ConfigServer::_connect(const char *ssid, const char *pass)
   }
   else
   {
-    I::get().logger() << F("[EWC CS]: Try to connect with saved credentials for SSID: ") << WiFi.SSID() << endl;
+    // next network of the ranked list or the network saved by the WiFi library
+    bool fromList = _candidateIndex < _candidates.size();
+    String candidateSsid = fromList ? _config.paramNetworks.at(_candidates[_candidateIndex]).ssid : WiFi.SSID();
+    String candidatePass = fromList ? _config.paramNetworks.at(_candidates[_candidateIndex]).pass : WiFi.psk();
+    // do not write the credentials and hints to flash on each connect
+    WiFi.persistent(false);
     WiFi.disconnect(false);
-    WiFi.begin();
+    if (_wifiCacheEnabled && _wifiCache.valid(candidateSsid))
+    {
+      I::get().logger() << F("[EWC CS]: Try to connect with saved credentials for SSID: ") << candidateSsid << F(" on channel ") << _wifiCache.channel() << endl;
+      _fastConnect = true;
+      if (!_config.paramStaIP && _wifiCache.hasLease())
+      {
+        WiFi.config(_wifiCache.ip(), _wifiCache.gateway(), _wifiCache.netmask(), _wifiCache.dns1(), _wifiCache.dns2());
+      }
+      WiFi.begin(candidateSsid.c_str(), candidatePass.c_str(), _wifiCache.channel(), _wifiCache.bssid());
+    }
+    else if (fromList)
+    {
+      I::get().logger() << F("[EWC CS]: Try to connect to known network ") << (uint32_t)(_candidateIndex + 1) << "/" << (uint32_t)_candidates.size() << F(", SSID: ") << candidateSsid << endl;
+      WiFi.begin(candidateSsid.c_str(), candidatePass.c_str());
+    }
+    else
+    {
+      I::get().logger() << F("[EWC CS]: Try to connect with saved credentials for SSID: ") << WiFi.SSID() << endl;
+      WiFi.begin();
+    }
+    WiFi.persistent(true);
   }
   // Start LED according to the WiFi condition if LED is available.
   if (WiFi.status() != WL_CONNECTED)
@@ -248,51 +331,142 @@ void ConfigServer::_connect(const char *ssid, const char *pass)
   }
 }
 
-#ifdef ESP8266
-void ConfigServer::_wifiOnStationModeConnected(const WiFiEventStationModeConnected &event)
+void ConfigServer::_fastConnectFailed()
 {
-  I::get().logger() << F("[EWC CS]: _wifiOnStationModeConnected: ") << event.ssid << endl;
-  if (!_config.paramAPStartAlways)
+  I::get().logger() << F("✘ [EWC CS]: connect with cached BSSID/channel failed, retry with scan") << endl;
+  _fastConnect = false;
+  _wifiCache.clear();
+  if (!_config.paramStaIP)
   {
-    _config.setBootMode(BootMode::NORMAL);
+    // back to DHCP
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
   }
-  _ap_disabled_after_timeout = false;
-  _disconnect_state = 0;
+  // reconnect to the same network in next loop
+  _wifiRetry = true;
+  _wifiActions |= _wifiState.handle(WiFiStateMachine::EV_RETRY);
 }
 
-void ConfigServer::_wifiOnStationModeDisconnected(const WiFiEventStationModeDisconnected &event)
+void ConfigServer::_startRound()
 {
-  I::get().logger() << F("✘ [EWC CS]: _wifiOnStationModeDisconnected: ") << event.ssid << ", code: " << event.reason << endl;
-  switch (event.reason)
+  _candidates = _config.paramNetworks.rank(_scanCache);
+  _candidateIndex = 0;
+}
+
+void ConfigServer::_wifiDisconnected(uint8_t reason)
+{
+  if (_wifiState.state() == WiFiStateMachine::CONNECTING && _candidateIndex + 1 < _candidates.size())
+  {
+    // try the next known network before the portal is opened
+    I::get().logger() << F("[EWC CS]: connect failed, try next known network") << endl;
+    _candidateIndex++;
+    _wifiRetry = true;
+    _wifiActions |= _wifiState.handle(WiFiStateMachine::EV_RETRY, reason);
+    return;
+  }
+  _wifiActions |= _wifiState.handle(WiFiStateMachine::EV_DISCONNECTED, reason);
+  I::get().logger() << F("[EWC CS]: reconnect in ") << _wifiState.remaining() << F(" ms") << endl;
+}
+
+/** Handles the WiFi events queued by the callbacks, called by loop(). **/
+void ConfigServer::_wifiEventLoop()
+{
+  uint32_t events = _wifiEvents.exchange(0);
+  if (events == 0)
+  {
+    return;
+  }
+  if (events & WIFI_EVENT_STA_CONNECTED)
+  {
+#ifdef ESP8266
+    if (!_config.paramAPStartAlways)
+#endif
+    {
+      _config.setBootMode(BootMode::NORMAL);
+    }
+    _disconnect_state = 0;
+  }
+  if (events & WIFI_EVENT_STA_DISCONNECTED)
+  {
+    _staDisconnected(_wifiEventReason);
+  }
+  if ((events & WIFI_EVENT_AP_STA_DISCONNECTED) && WiFi.status() == WL_CONNECTED && !_config.paramAPStartAlways)
+  {
+    I::get().logger() << F("[EWC CS]: disable AP after successfully connected") << endl;
+    WiFi.mode(WIFI_STA);
+    _ap_address = IPAddress((uint32_t)0);
+    _wifiState.portalStopped();
+  }
+}
+
+void ConfigServer::_staDisconnected(uint8_t reason)
+{
+  _metrics.wifiDisconnected(reason);
+  if (_fastConnect)
+  {
+    _fastConnectFailed();
+    return;
+  }
+  _disconnect_state = reason;
+  switch (reason)
   {
+#ifdef ESP8266
   case WIFI_DISCONNECT_REASON_NO_AP_FOUND:
+#else
+  case wifi_err_reason_t::WIFI_REASON_NO_AP_FOUND:
+#endif
   {
-    _disconnect_state = event.reason;
     _disconnect_reason = "No AP found";
     break;
   }
+#ifdef ESP8266
   case WIFI_DISCONNECT_REASON_AUTH_EXPIRE:
   case WIFI_DISCONNECT_REASON_AUTH_FAIL:
+#else
+  case wifi_err_reason_t::WIFI_REASON_AUTH_EXPIRE:
+#endif
   {
-    _disconnect_state = event.reason;
     _disconnect_reason = "Authentication failed";
     break;
   }
   default:
   {
-    _disconnect_state = event.reason;
-    if (event.reason > 0)
+    if (reason > 0)
     {
-      _disconnect_reason = "Failed, error: " + String(event.reason);
+      _disconnect_reason = "Failed, error: " + String(reason);
     }
   }
   }
-  // set time if we should reconnect
-  if (_reconnectTs == 0)
+  _wifiDisconnected(reason);
+}
+
+/** The callbacks only queue the events for _wifiEventLoop(): on ESP32 they run in the WiFi task,
+ * concurrently to loop() which owns the state machine. **/
+void ConfigServer::_queueDisconnect(uint8_t reason)
+{
+#ifdef ESP8266
+  if (reason == WIFI_DISCONNECT_REASON_ASSOC_LEAVE)
+#else
+  if (reason == wifi_err_reason_t::WIFI_REASON_ASSOC_LEAVE)
+#endif
   {
-    I::get().logger() << F("[EWC CS]: start reconnect Timer in 15 sec") << endl;
-    _reconnectTs = millis() + 10000;
+    // ignore the leave caused by our own disconnect() before begin()
+    return;
   }
+  _wifiEventReason = reason;
+  _wifiEvents.fetch_or(WIFI_EVENT_STA_DISCONNECTED);
+}
+
+#ifdef ESP8266
+void ConfigServer::_wifiOnStationModeConnected(const WiFiEventStationModeConnected &event)
+{
+  I::get().logger() << F("[EWC CS]: _wifiOnStationModeConnected: ") << event.ssid << endl;
+  _wifiEvents.fetch_or(WIFI_EVENT_STA_CONNECTED);
+}
+
+void ConfigServer::_wifiOnStationModeDisconnected(const WiFiEventStationModeDisconnected &event)
+{
+  I::get().logger() << F("✘ [EWC CS]: _wifiOnStationModeDisconnected: ") << event.ssid << ", code: " << event.reason << endl;
+  _queueDisconnect(event.reason);
 }
 
 // void ConfigServer::_wifiOnStationModeAuthModeChanged(const WiFiEventStationModeAuthModeChanged& event)
@@ -316,67 +490,21 @@ void ConfigServer::_wifiOnSoftAPModeStationDisconnected(const WiFiEventSoftAPMod
 {
   I::get().logger() << F("[EWC CS]: _wifiOnSoftAPModeStationDisconnected: ") << endl;
   _softAPClientCount--;
-  if (WiFi.status() == WL_CONNECTED && !_config.paramAPStartAlways)
-  {
-    I::get().logger() << F("[EWC CS]: disable AP after successfully connected") << endl;
-    WiFi.mode(WIFI_STA);
-  }
+  _wifiEvents.fetch_or(WIFI_EVENT_AP_STA_DISCONNECTED);
 }
 #else
 void ConfigServer::_wifiOnStationModeConnected(WiFiEvent_t event, WiFiEventInfo_t info)
 {
   I::get().logger() << F("[EWC CS]: _wifiOnStationModeConnected: ") << String(info.wifi_sta_connected.ssid, sizeof(info.wifi_sta_connected.ssid)) << endl;
-  _config.setBootMode(BootMode::NORMAL);
-  _ap_disabled_after_timeout = false;
-  _disconnect_state = 0;
+  _wifiEvents.fetch_or(WIFI_EVENT_STA_CONNECTED);
 }
 
 void ConfigServer::_wifiOnStationModeDisconnected(WiFiEvent_t event, WiFiEventInfo_t info)
 {
   I::get().logger() << F("✘ [EWC CS]: _wifiOnStationModeDisconnected: ") << String(info.wifi_sta_disconnected.ssid, sizeof(info.wifi_sta_disconnected.ssid)) << ", code: " << info.wifi_sta_disconnected.reason << endl;
-  switch (info.wifi_sta_disconnected.reason)
-  {
-  case wifi_err_reason_t::WIFI_REASON_NO_AP_FOUND:
-  {
-    _disconnect_state = info.wifi_sta_disconnected.reason;
-    _disconnect_reason = "No AP found";
-    break;
-  }
-  case wifi_err_reason_t::WIFI_REASON_AUTH_EXPIRE:
-  {
-    _disconnect_state = info.wifi_sta_disconnected.reason;
-    _disconnect_reason = "Authentication failed";
-    break;
-  }
-  default:
-  {
-    _disconnect_state = info.wifi_sta_disconnected.reason;
-    if (info.wifi_sta_disconnected.reason > 0)
-    {
-      _disconnect_reason = "Failed, error: " + String(info.wifi_sta_disconnected.reason);
-    }
-  }
-  }
-  // set time if we should reconnect
-  if (_reconnectTs == 0)
-  {
-    I::get().logger() << F("[EWC CS]: start reconnect Timer in 15 sec") << endl;
-    _reconnectTs = millis() + 10000;
-  }
+  _queueDisconnect(info.wifi_sta_disconnected.reason);
 }
 
-// void ConfigServer::_wifiOnStationModeAuthModeChanged(const WiFiEventStationModeAuthModeChanged& event)
-// {
-//     I::get().logger() << F("[EWC CS]: _wifiOnStationModeAuthModeChanged: ") << event.newMode << endl;
-// }
-// void ConfigServer::_wifiOnStationModeGotIP(const WiFiEventStationModeGotIP& event)
-// {
-//     I::get().logger() << F("[EWC CS]: _wifiOnStationModeGotIP: ") << event.ip << endl;
-// }
-// void ConfigServer::_wifiOnStationModeDHCPTimeout()
-// {
-//     I::get().logger() << F("✘ [EWC CS]: _wifiOnStationModeDHCPTimeout: ") << endl;
-// }
 void ConfigServer::_wifiOnSoftAPModeStationConnected(WiFiEvent_t event, WiFiEventInfo_t info)
 {
   I::get().logger() << F("[EWC CS]: _wifiOnSoftAPModeStationConnected: ") << endl;
@@ -386,11 +514,7 @@ void ConfigServer::_wifiOnSoftAPModeStationDisconnected(WiFiEvent_t event, WiFiE
 {
   I::get().logger() << F("[EWC CS]: _wifiOnSoftAPModeStationDisconnected: ") << endl;
   _softAPClientCount--;
-  if (WiFi.status() == WL_CONNECTED && !_config.paramAPStartAlways)
-  {
-    I::get().logger() << F("[EWC CS]: disable AP after successfully connected") << endl;
-    WiFi.mode(WIFI_STA);
-  }
+  _wifiEvents.fetch_or(WIFI_EVENT_AP_STA_DISCONNECTED);
 }
 #endif
 
@@ -419,6 +543,7 @@ void ConfigServer::insertMenu(const char *name, const char *uri, const char *ent
     I::get().logger() << F("[EWC CS]: insert menu item: ") << name << F(", at position: ") << position << endl;
     _menu.insert(_menu.begin() + position, item);
   }
+  _configFS.bumpGeneration();
 }
 
 void ConfigServer::insertMenuCb(const char *name, const char *uri, const char *entry_id, WebServerHandlerFunction onRequest, bool visible, int position)
@@ -432,9 +557,9 @@ void ConfigServer::insertMenuP(const char *name, const char *uri, const char *en
   insertMenuCb(name, uri, entry_id, std::bind(&ConfigServer::sendContentP, this, &_server, contentType, content), visible, position);
 }
 
-void ConfigServer::insertMenuG(const char *name, const char *uri, const char *entry_id, const String &contentType, const uint8_t *content, size_t len, bool visible, int position)
+void ConfigServer::insertMenuG(const char *name, const char *uri, const char *entry_id, const String &contentType, const uint8_t *content, size_t len, bool visible, int position, PGM_P etag)
 {
-  insertMenuCb(name, uri, entry_id, std::bind(&ConfigServer::sendContentG, this, &_server, contentType, content, len), visible, position);
+  insertMenuCb(name, uri, entry_id, std::bind(&ConfigServer::sendContentG, this, &_server, contentType, content, len, etag), visible, position);
 }
 
 void ConfigServer::insertMenuNoAuthP(const char *name, const char *uri, const char *entry_id, const String &contentType, PGM_P content, bool visible, int position)
@@ -442,9 +567,101 @@ void ConfigServer::insertMenuNoAuthP(const char *name, const char *uri, const ch
   insertMenuCb(name, uri, entry_id, std::bind(&ConfigServer::_sendContentNoAuthP, this, &_server, contentType, content), visible, position);
 }
 
-void ConfigServer::insertMenuNoAuthG(const char *name, const char *uri, const char *entry_id, const String &contentType, const uint8_t *content, size_t len, bool visible, int position)
+void ConfigServer::insertMenuNoAuthG(const char *name, const char *uri, const char *entry_id, const String &contentType, const uint8_t *content, size_t len, bool visible, int position, PGM_P etag)
 {
-  insertMenuCb(name, uri, entry_id, std::bind(&ConfigServer::_sendContentNoAuthG, this, &_server, contentType, content, len), visible, position);
+  insertMenuCb(name, uri, entry_id, std::bind(&ConfigServer::_sendContentNoAuthG, this, &_server, contentType, content, len, etag), visible, position);
+}
+
+void ConfigServer::insertMenuA(const char *name, const char *uri, const char *entry_id, bool visible, int position)
+{
+  insertMenu(name, uri, entry_id, visible, position);
+  enableAsset(uri);
+}
+
+void ConfigServer::addAssets(AssetTable &table)
+{
+  _assetTables.push_back(&table);
+}
+
+bool ConfigServer::enableAsset(const char *uri, bool noAuth)
+{
+  AssetTable *table;
+  size_t index;
+  if (!_findAsset(uri, table, index))
+  {
+    I::get().logger() << F("✘ [EWC CS]: no generated asset found for ") << uri << endl;
+    return false;
+  }
+  table->flags[index] = ASSET_ENABLED | (noAuth ? ASSET_NO_AUTH : 0);
+  return true;
+}
+
+/** Searches the path in the manifests by binary search, ignoring the case like the file names of the baseline routes
+ * (e.g. /css/wifiicons.css for web/css/wifiIcons.css). Manifests added later are searched first. **/
+bool ConfigServer::_findAsset(const char *uri, AssetTable *&table, size_t &index)
+{
+  for (auto it = _assetTables.rbegin(); it != _assetTables.rend(); ++it)
+  {
+    size_t lo = 0;
+    size_t hi = (*it)->count;
+    while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      int cmp = strcasecmp_P(uri, (PGM_P)pgm_read_ptr(&(*it)->entries[mid].path));
+      if (cmp == 0)
+      {
+        table = *it;
+        index = mid;
+        return true;
+      }
+      if (cmp < 0)
+      {
+        hi = mid;
+      }
+      else
+      {
+        lo = mid + 1;
+      }
+    }
+  }
+  return false;
+}
+
+void ConfigServer::_sendAsset(WebServer *webServer, const AssetTable &table, size_t index)
+{
+  EWC_PROFILE_SCOPE("cs.asset");
+  AssetEntry entry;
+  memcpy_P(&entry, &table.entries[index], sizeof(AssetEntry));
+  _sendContentNoAuthG(webServer, FPSTR(_assetMimeType(entry.mime)), entry.gzip, entry.len, entry.etag);
+}
+
+bool ConfigServer::_sendAsset(WebServer *webServer, const char *uri)
+{
+  AssetTable *table;
+  size_t index;
+  if (!_findAsset(uri, table, index))
+  {
+    return false;
+  }
+  _sendAsset(webServer, *table, index);
+  return true;
+}
+
+PGM_P ConfigServer::_assetMimeType(uint8_t mime)
+{
+  switch (mime)
+  {
+  case ASSET_MIME_CSS:
+    return PROGMEM_CONFIG_TEXT_CSS;
+  case ASSET_MIME_JS:
+    return PROGMEM_CONFIG_APPLICATION_JS;
+  case ASSET_MIME_JSON:
+    return PROGMEM_CONFIG_APPLICATION_JSON;
+  case ASSET_MIME_SVG:
+    return PROGMEM_CONFIG_IMAGE_SVG;
+  default:
+    return PROGMEM_CONFIG_TEXT_HTML;
+  }
 }
 
 String ConfigServer::_token_WIFI_MODE()
@@ -494,18 +711,10 @@ String ConfigServer::_toMACAddressString(const uint8_t mac[])
   return macAddr;
 }
 
-void ConfigServer::_onAccessGet(WebServer *webServer)
+void ConfigServer::_fillAccess(JsonDocument &jsonDoc)
 {
-  if (!isAuthenticated(webServer))
-  {
-    return webServer->requestAuthentication();
-  }
-  JsonDocument jsonDoc;
-  JsonObject json = jsonDoc.to<JsonObject>();
-  _config.fillJson(jsonDoc);
-  String output;
-  serializeJson(json, output);
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
+  // the response is cached and served to each client of the portal
+  _config.fillJson(jsonDoc, false);
 }
 
 void ConfigServer::_onAccessSave(WebServer *webServer)
@@ -514,61 +723,16 @@ void ConfigServer::_onAccessSave(WebServer *webServer)
   {
     return webServer->requestAuthentication();
   }
-  // I::get().logger() << "[EWC CS]: handle args: " << webServer->args() << endl;
-  // for (int i = 0; i < webServer->args(); i++) {
-  //     I::get().logger() << "[EWC CS]:   " << webServer->argName(i) << ": " << webServer->arg(i) << endl;
-  // }
-  if (webServer->hasArg("dev_name"))
-  {
-    _config.paramDeviceName = webServer->arg("dev_name");
-  }
-  if (webServer->hasArg("apName"))
-  {
-    _config.paramAPName = webServer->arg("apName");
-  }
-  if (webServer->hasArg("apPass"))
-  {
-    _config.setAPPass(webServer->arg("apPass"));
-  }
-  if (webServer->hasArg("ap_start_always"))
-  {
-    _config.paramAPStartAlways = webServer->arg("ap_start_always").equals("true");
-  }
-  else
-  {
-    _config.paramAPStartAlways = false;
-  }
-  if (webServer->hasArg("basic_auth"))
-  {
-    _config.paramBasicAuth = webServer->arg("basic_auth").equals("true");
-  }
-  else
-  {
-    _config.paramBasicAuth = false;
-  }
-  if (webServer->hasArg("httpUser"))
-  {
-    _config.paramHttpUser = webServer->arg("httpUser");
-  }
-  if (webServer->hasArg("httpPass"))
-  {
-    _config.paramHttpPassword = webServer->arg("httpPass");
-  }
-  if (webServer->hasArg("hostname"))
-  {
-    _config.paramHostname = webServer->arg("hostname");
-  }
-  I::get().configFS().save();
+  // the passwords are not sent to the page, an empty field keeps the stored one
+  _config.fromForm(webServer);
+  // the sessions were authenticated with the old credentials
+  _sessions.clear();
+  _configFS.save(_config);
   sendPageSuccess(webServer, "Security save", "Save successful! Please, restart to apply AP changes!", "/access/setup");
 }
 
-void ConfigServer::_onGetInfo(WebServer *webServer)
+void ConfigServer::_fillInfo(JsonDocument &jsonDoc)
 {
-  if (!isAuthenticated(webServer))
-  {
-    return webServer->requestAuthentication();
-  }
-  JsonDocument jsonDoc;
   JsonObject json = jsonDoc.to<JsonObject>();
   json["version"] = _version;
   json["estab_ssid"] = WiFi.status() == WL_CONNECTED ? WiFi.SSID() : String(F("N/A"));
@@ -594,23 +758,14 @@ void ConfigServer::_onGetInfo(WebServer *webServer)
   json["flash_size"] = String(spi_flash_get_chip_size());
 #endif
   json["free_heap"] = String(ESP.getFreeHeap());
-  String output;
-  serializeJson(json, output);
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
+  json["cache_hits"] = _responseCache.hits();
+  json["cache_misses"] = _responseCache.misses();
+  json["cache_used"] = _responseCache.used();
 }
 
-void ConfigServer::_onLoggingGet(WebServer *webServer)
+void ConfigServer::_fillLogging(JsonDocument &jsonDoc)
 {
-  if (!isAuthenticated(webServer))
-  {
-    return webServer->requestAuthentication();
-  }
-  JsonDocument jsonDoc;
-  JsonObject json = jsonDoc.to<JsonObject>();
-  _config.fillJson(jsonDoc);
-  String output;
-  serializeJson(json, output);
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
+  _config.fillJson(jsonDoc, false);
 }
 
 void ConfigServer::_onLoggingEnable(WebServer *webServer)
@@ -631,7 +786,7 @@ void ConfigServer::_onLoggingEnable(WebServer *webServer)
   {
     I::get().logger().setLogging(false);
   }
-  I::get().configFS().save();
+  I::get().configFS().save(_config);
   sendRedirect(webServer, "/logging/setup");
 }
 
@@ -645,40 +800,52 @@ void ConfigServer::_onWiFiConnect(WebServer *webServer)
   {
     I::get().logger() << "[EWC CS]: " << idx << ": " << webServer->argName(idx) << webServer->arg(idx) << endl;
   }
-  if (webServer->hasArg("stationIP"))
+  bool dhcp = webServer->hasArg("dhcp");
+  _staticIPFromArg(webServer, "stationIP", dhcp, _config.paramStaIP);
+  _staticIPFromArg(webServer, "gateway", dhcp, _config.paramStaGateway);
+  _staticIPFromArg(webServer, "netmask", dhcp, _config.paramStaNetmask);
+  _staticIPFromArg(webServer, "dns1", dhcp, _config.paramStaDns1);
+  _staticIPFromArg(webServer, "dns2", dhcp, _config.paramStaDns2);
+  if (!_config.paramStaIP)
   {
-    I::get().logger() << F("[EWC CS]: static ip: ") << webServer->arg("stationIP") << endl;
-    String ip = webServer->arg("stationIP");
-    _optionalIPFromString(&_sta_static_ip, ip.c_str());
+    // back to DHCP if a static configuration was applied before
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
   }
-  if (webServer->hasArg("gateway"))
+  String ssid = webServer->arg("ssid");
+  if (!ssid.isEmpty())
   {
-    I::get().logger() << F("[EWC CS]: static gateway") << webServer->arg("gateway") << endl;
-    String gw = webServer->arg("gateway");
-    _optionalIPFromString(&_sta_static_gw, gw.c_str());
+    _config.paramNetworks.add(ssid, webServer->arg("passphrase"));
   }
-  if (webServer->hasArg("netmask"))
+  // store the network and static configuration to apply it on next boot
+  _configFS.save(_config);
+  _sendAsset(webServer, "/wifi/state.html");
+  // const char* ssid = webServer->arg("ssid").c_str();
+  // const char* pass = webServer->arg("passphrase").c_str();
+  _wifiState.handle(WiFiStateMachine::EV_BEGIN);
+  _startRound();
+  if (!ssid.isEmpty())
   {
-    I::get().logger() << F("[EWC CS]: static netmask") << webServer->arg("netmask") << endl;
-    String sn = webServer->arg("netmask");
-    _optionalIPFromString(&_sta_static_sn, sn.c_str());
+    // the new network first, the other known networks on failure
+    std::vector<uint8_t>::iterator it = std::find(_candidates.begin(), _candidates.end(), 0);
+    if (it != _candidates.end())
+    {
+      std::rotate(_candidates.begin(), it, it + 1);
+    }
   }
-  if (webServer->hasArg("dns1"))
+  _connect(ssid.c_str(), webServer->arg("passphrase").c_str());
+}
+
+void ConfigServer::_staticIPFromArg(WebServer *webServer, const char *name, bool dhcp, IPAddress &ip)
+{
+  String value = webServer->arg(name);
+  if (dhcp || value.isEmpty() || !_optionalIPFromString(&ip, value.c_str()))
   {
-    I::get().logger() << F("[EWC CS]: static DNS 1") << webServer->arg("dns1") << endl;
-    String dns1 = webServer->arg("dns1");
-    _optionalIPFromString(&_sta_static_dns1, dns1.c_str());
+    ip = IPAddress((uint32_t)0);
   }
-  if (webServer->hasArg("dns2"))
+  else
   {
-    I::get().logger() << F("[EWC CS]: static DNS 2") << webServer->arg("dns2") << endl;
-    String dns2 = webServer->arg("dns2");
-    _optionalIPFromString(&_sta_static_dns2, dns2.c_str());
+    I::get().logger() << F("[EWC CS]: static ") << name << F(": ") << ip << endl;
   }
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_TEXT_HTML), FPSTR(HTML_WIFI_STATE));
-  // const char* ssid = webServer->arg("ssid").c_str();
-  // const char* pass = webServer->arg("passphrase").c_str();
-  _connect(webServer->arg("ssid").c_str(), webServer->arg("passphrase").c_str());
 }
 
 void ConfigServer::_onWiFiDisconnect(WebServer *webServer)
@@ -689,16 +856,48 @@ void ConfigServer::_onWiFiDisconnect(WebServer *webServer)
   }
   webServer->sendHeader("Location", "/wifi/setup");
   webServer->send(302, "text/plain", "");
+  _wifiCache.clear();
+  _wifiState.handle(WiFiStateMachine::EV_STOP);
   WiFi.disconnect(false);
 }
 
-void ConfigServer::_sendMenu(WebServer *webServer)
+void ConfigServer::_onWiFiNetworkRemove(WebServer *webServer)
 {
   if (!isAuthenticated(webServer))
   {
     return webServer->requestAuthentication();
   }
-  JsonDocument jsonDoc;
+  if (_config.paramNetworks.remove(webServer->arg("ssid")))
+  {
+    I::get().logger() << F("[EWC CS]: removed known network: ") << webServer->arg("ssid") << endl;
+    // the indexes of the current round are no longer valid
+    _candidates.clear();
+    _candidateIndex = 0;
+    _configFS.save(_config);
+  }
+  webServer->sendHeader("Location", "/wifi/setup");
+  webServer->send(302, "text/plain", "");
+}
+
+void ConfigServer::_fillWifiNetworks(JsonDocument &jsonDoc)
+{
+  JsonArray networks = jsonDoc["networks"].to<JsonArray>();
+  for (size_t i = 0; i < _config.paramNetworks.count(); i++)
+  {
+    const WiFiNetworks::Credential &network = _config.paramNetworks.at(i);
+    JsonObject entry = networks.add<JsonObject>();
+    entry["ssid"] = network.ssid;
+    int found = _scanCache.find(network.ssid);
+    if (found >= 0)
+    {
+      entry["rssi"] = _scanCache.at(found).rssi;
+    }
+    entry["connected"] = isConnected() && WiFi.SSID() == network.ssid;
+  }
+}
+
+void ConfigServer::_fillMenu(JsonDocument &jsonDoc)
+{
   jsonDoc["brand"] = _brand;
   jsonDoc["brandUri"] = _brandUri;
   jsonDoc["language"] = _config.paramLanguage;
@@ -712,20 +911,12 @@ void ConfigServer::_sendMenu(WebServer *webServer)
     jsonElements["href"] = it->link;
     jsonElements["visible"] = it->visible;
   }
-  String output;
-  serializeJson(jsonDoc, output);
-  I::get().logger() << "[EWC CS]: ESP heap: _sendMenu: " << ESP.getFreeHeap() << ", json overflowed: " << jsonDoc.overflowed() << endl;
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
+  I::get().logger() << "[EWC CS]: ESP heap: _fillMenu: " << ESP.getFreeHeap() << ", json overflowed: " << jsonDoc.overflowed() << endl;
 }
 
-void ConfigServer::_onWifiState(WebServer *webServer)
+void ConfigServer::_fillWifiState(JsonDocument &jsonDoc)
 {
-  if (!isAuthenticated(webServer))
-  {
-    return webServer->requestAuthentication();
-  }
   I::get().logger() << "[EWC CS]: report WifiState, connected: " << (WiFi.status() == WL_CONNECTED) << endl;
-  JsonDocument jsonDoc;
   JsonObject json = jsonDoc.to<JsonObject>();
   json["ssid"] = WiFi.SSID();
   json["connected"] = WiFi.status() == WL_CONNECTED;
@@ -739,9 +930,53 @@ void ConfigServer::_onWifiState(WebServer *webServer)
   {
     json["local_ip"] = "";
   }
-  String output;
-  serializeJson(json, output);
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
+  json["dhcp"] = !_config.paramStaIP;
+  if (_config.paramStaIP)
+  {
+    json["stationIP"] = _config.paramStaIP.toString();
+    // an unset address would be "(IP unset)" on ESP8266
+    json["gateway"] = _config.paramStaGateway ? _config.paramStaGateway.toString() : "";
+    json["netmask"] = _config.paramStaNetmask ? _config.paramStaNetmask.toString() : "";
+    json["dns1"] = _config.paramStaDns1 ? _config.paramStaDns1.toString() : "";
+    json["dns2"] = _config.paramStaDns2 ? _config.paramStaDns2.toString() : "";
+  }
+}
+
+void ConfigServer::_fillWifiTrace(JsonDocument &jsonDoc)
+{
+  jsonDoc["state"] = WiFiStateMachine::stateName(_wifiState.state());
+  jsonDoc["portal"] = WiFiStateMachine::portalName(_wifiState.portal());
+  jsonDoc["attempts"] = _wifiState.attempts();
+  jsonDoc["remaining_ms"] = _wifiState.remaining();
+  jsonDoc["now"] = millis();
+  JsonArray trace = jsonDoc["trace"].to<JsonArray>();
+  for (uint8_t i = 0; i < _wifiState.traceCount(); i++)
+  {
+    const WiFiStateMachine::Transition &t = _wifiState.trace(i);
+    JsonObject entry = trace.add<JsonObject>();
+    entry["ts"] = t.ts;
+    entry["from"] = WiFiStateMachine::stateName(t.from);
+    entry["to"] = WiFiStateMachine::stateName(t.to);
+    entry["event"] = WiFiStateMachine::eventName(t.event);
+    entry["reason"] = t.reason;
+  }
+}
+
+/** Version of the values reported by _fillWifiState(). **/
+uint32_t ConfigServer::_wifiStateVersion()
+{
+  return VersionTag()
+      .add(WiFi.status())
+      .add(_disconnect_state)
+      .add(_disconnect_reason)
+      .add(WiFi.SSID())
+      .add((uint32_t)WiFi.localIP())
+      .add((uint32_t)_config.paramStaIP)
+      .add((uint32_t)_config.paramStaGateway)
+      .add((uint32_t)_config.paramStaNetmask)
+      .add((uint32_t)_config.paramStaDns1)
+      .add((uint32_t)_config.paramStaDns2)
+      .value();
 }
 
 void _wiFiState2Json(JsonObject &json, bool finished, bool failed, const char *reason)
@@ -751,184 +986,182 @@ void _wiFiState2Json(JsonObject &json, bool finished, bool failed, const char *r
   json["reason"] = reason;
 }
 
-void ConfigServer::_onWifiScan(WebServer *webServer)
+void ConfigServer::_fillWifiScan(JsonDocument &jsonDoc)
 {
-  if (!isAuthenticated(webServer))
+  // start next sweep if the last is older than EWC_SCAN_INTERVAL_MS, restart at once if no scan result was read
+  _startWiFiScan(_scanCache.json().isEmpty());
+  if (!_scanCache.json().isEmpty())
   {
-    return webServer->requestAuthentication();
+    // serve the merged results until the next scan is read
+    jsonDoc.set(serialized(_scanCache.json()));
+    return;
   }
-  _startWiFiScan();
-  int n = WiFi.scanComplete();
-  JsonDocument jsonDoc;
   JsonObject json = jsonDoc.to<JsonObject>();
-  if (n == WIFI_SCAN_FAILED)
+  _wiFiState2Json(json, false, false, "");
+  json["networks"].to<JsonArray>();
+}
+
+void ConfigServer::loop()
+{
+  EWC_PROFILE_SCOPE("cs.loop");
+  _metrics.loop();
+  _configFS.loop();
+  _led.loop();
+  if (WiFi.getMode() == WIFI_AP_STA)
   {
-    I::get().logger() << F("[EWC CS]: scanNetworks returned: WIFI_SCAN_FAILED!") << endl;
-    _wiFiState2Json(json, true, true, "scanNetworks returned: WIFI_SCAN_FAILED!");
+    EWC_PROFILE_SCOPE("cs.dns");
+    _dnsServer.processNextRequest();
   }
-  else if (n == WIFI_SCAN_RUNNING)
   {
-    I::get().logger() << F("[EWC CS]: scanNetworks returned: WIFI_SCAN_RUNNING!") << endl;
-    _wiFiState2Json(json, false, false, "");
+    EWC_PROFILE_SCOPE("cs.http");
+    _server.handleClient();
   }
-  else if (n < 0)
+  if (_metrics.requestFinished(_server.uri()))
   {
-    I::get().logger() << F("[EWC CS]: scanNetworks failed with unknown error code!") << endl;
-    _wiFiState2Json(json, true, true, "scanNetworks failed with unknown error code!");
+    _scanScheduler.activity(millis());
   }
-  else if (n == 0)
+#ifdef EWC_PROFILE
+  if (EWC_PROFILE_REPORT_MS > 0 && millis() - _profileReportTs > EWC_PROFILE_REPORT_MS)
   {
-    I::get().logger() << F("✘ [EWC CS]: No networks found") << endl;
-    _wiFiState2Json(json, true, true, "No networks found");
+    _profileReportTs = millis();
+    Profiler::print(I::get().logger());
   }
-  JsonArray networks = jsonDoc["networks"].to<JsonArray>();
-  if (n > 0)
-  {
-    _wiFiState2Json(json, true, false, "");
-    std::vector<String> ssids;
-    String ssid;
-    uint8_t encType;
-    int32_t rssi;
-    uint8_t *bssid;
-    int32_t channel;
-    bool isHidden;
-    for (uint8_t i = 0; i < n; i++)
-    {
-#ifdef ESP8266
-      bool result = WiFi.getNetworkInfo(i, ssid, encType, rssi, bssid, channel, isHidden);
-#else
-      bool result = WiFi.getNetworkInfo(i, ssid, encType, rssi, bssid, channel);
 #endif
-      // do not add the same station twice
-      if (result && !ssid.isEmpty() && std::find(ssids.begin(), ssids.end(), ssid) == ssids.end())
+  if (!_config.paramWifiDisabled)
+  {
+    _wifiEventLoop();
+    if (WiFi.status() != WL_CONNECTED)
+    {
+      if (_fastConnect && millis() - _msConnectStart > EWC_WIFI_FAST_TIMEOUT_MS)
       {
-        JsonObject jsonNetwork = networks.add<JsonObject>();
-        jsonNetwork["ssid"] = ssid;
-#ifdef ESP8266
-        jsonNetwork["encrypted"] = encType == ENC_TYPE_NONE ? false : true;
-#else
-        jsonNetwork["encrypted"] = encType == wifi_auth_mode_t::WIFI_AUTH_OPEN ? false : true;
-#endif
-        jsonNetwork["rssi"] = rssi;
-        jsonNetwork["channel"] = channel;
-        char mac[18] = {0};
-        sprintf(mac, "%02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
-        jsonNetwork["bssid"] = mac;
-        jsonNetwork["hidden"] = false;
-        ssids.push_back(ssid);
+        _fastConnectFailed();
+      }
+      if (WiFi.SSID().length() == 0)
+      {
+        _wifiActions |= _wifiState.handle(WiFiStateMachine::EV_NO_SSID);
       }
     }
-    String output;
-    serializeJson(json, output);
-    webServer->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
-    // WiFi.scanDelete();
-    return;
+    else if (_wifiState.state() != WiFiStateMachine::CONNECTED)
+    {
+      _wifiActions |= _wifiState.handle(WiFiStateMachine::EV_CONNECTED);
+    }
+    _scanLoop();
+    if (_roamingEnabled && _wifiState.state() == WiFiStateMachine::CONNECTED)
+    {
+      _roamingLoop();
+    }
+    uint8_t actions = _wifiActions | _wifiState.poll(_softAPClientCount <= 0);
+    _wifiActions = 0;
+    if (actions != WiFiStateMachine::ACT_NONE)
+    {
+      _wifiExecute(actions);
+    }
   }
-  else if (n == -2)
+}
+
+void ConfigServer::_roamingLoop()
+{
+  if (_roaming.scanning())
   {
-    _startWiFiScan(true);
-    _wiFiState2Json(json, false, false, "");
+    if (_scanCache.generation() != _roamingGeneration)
+    {
+      String ssid = WiFi.SSID();
+      int found = _scanCache.find(ssid);
+      bool same = found >= 0 && memcmp(_scanCache.at(found).bssid, WiFi.BSSID(), 6) == 0;
+      int8_t rssi = found >= 0 ? _scanCache.at(found).rssi : 0;
+      Roaming::Decision decision = _roaming.evaluate(found >= 0, same, rssi);
+      I::get().logger() << F("[EWC CS]: roaming ") << Roaming::decisionName(decision) << F(", average RSSI: ") << (int32_t)_roaming.average() << F(", best: ") << (int32_t)rssi << (same ? F(" (current)") : F("")) << endl;
+      _metrics.wifiRoamDecision(decision == Roaming::ROAM);
+      if (decision == Roaming::ROAM)
+      {
+        const ScanCache::Network &network = _scanCache.at(found);
+        I::get().logger() << F("[EWC CS]: roam to channel ") << (uint32_t)network.channel << endl;
+        // handled like a fast connect: on failure the normal reconnect follows
+        _wifiState.handle(WiFiStateMachine::EV_BEGIN);
+        _fastConnect = true;
+        _msConnectStart = millis();
+        String pass = WiFi.psk();
+        WiFi.persistent(false);
+        WiFi.disconnect(false);
+        WiFi.begin(ssid.c_str(), pass.c_str(), network.channel, network.bssid);
+        WiFi.persistent(true);
+        return;
+      }
+    }
+  }
+  if (millis() - _roamingSampleTs >= EWC_ROAMING_SAMPLE_MS)
+  {
+    _roamingSampleTs = millis();
+    if (_roaming.sample(WiFi.RSSI(), millis()) == Roaming::SCAN)
+    {
+      I::get().logger() << F("[EWC CS]: roaming scan, average RSSI: ") << (int32_t)_roaming.average() << endl;
+      _metrics.wifiRoamScan();
+      _roamingGeneration = _scanCache.generation();
+      _startWiFiScan(true);
+    }
   }
-  String output;
-  serializeJson(json, output);
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
 }
 
-void ConfigServer::loop()
+void ConfigServer::_wifiExecute(uint8_t actions)
 {
-  _led.loop();
-  if (WiFi.getMode() == WIFI_AP_STA)
+  if (actions & WiFiStateMachine::ACT_CONNECT)
   {
-    _dnsServer.processNextRequest();
+    I::get().logger() << F("[EWC CS]: reconnect to WiFi, attempt ") << _wifiState.attempts() << endl;
+    _metrics.wifiReconnect();
+    if (!_wifiRetry)
+    {
+      // new round starting with the best visible network
+      _startRound();
+    }
+    _wifiRetry = false;
+    _connect();
   }
-  _server.handleClient();
-  if (!_config.paramWifiDisabled)
+  if ((actions & WiFiStateMachine::ACT_START_AP) && !isAP())
   {
-    if (WiFi.status() != WL_CONNECTED)
+    I::get().logger() << F("[EWC CS]: start AP, disconnect state: ") << (uint32_t)_disconnect_state << F(", SSID: '") << WiFi.SSID() << "'" << endl;
+    I::get().logger() << F("[EWC CS]: change WiFi mode to AP_STA") << endl;
+    WiFi.mode(WIFI_AP_STA);
+    _startAP();
+  }
+  if (actions & WiFiStateMachine::ACT_STOP_AP)
+  {
+    _dnsServer.stop();
+    _ap_address = IPAddress((uint32_t)0);
+    if (WiFi.SSID().length() == 0 && WiFi.status() != WL_CONNECTED)
     {
-      if (_reconnectTs > 0 && millis() > _reconnectTs)
-      {
-        _reconnectTs = 0;
-        I::get().logger() << F("[EWC CS]: reconnect to WiFi...") << endl;
-        _connect();
-      }
-      // after _msConfigPortalTimeout the portal will be disabled
-      // this can be enabled after restart or successful connect
-      if (!_ap_disabled_after_timeout)
-      {
-        _connected_wifi = false;
-        bool startAP = false;
-        // check for timeout
-        if (millis() - _msConnectStart > _msConnectTimeout)
-        {
-          startAP = true;
-        }
-        else
-        {
-          // check for errors
-          if (_disconnect_state > 0)
-          {
-            startAP = true;
-          }
-          else if (WiFi.SSID().length() == 0)
-          {
-            // check for valid WiFi credentials
-            startAP = true;
-          }
-        }
-        if (startAP && !isAP())
-        {
-          if (millis() - _msConnectStart > _msConnectTimeout)
-          {
-            I::get().logger() << F("[EWC CS]: _msConnectTimeout=") << _msConnectTimeout << ", start AP" << endl;
-          }
-
-          if (_disconnect_state > 0)
-          {
-            I::get().logger() << F("[EWC CS]: _disconnect_state=") << _disconnect_state << ", start AP" << endl;
-          }
-          else if (WiFi.SSID().length() == 0)
-          {
-            I::get().logger() << F("[EWC CS]: SSID is empty, start AP") << endl;
-          }
-          // start AP
-          I::get().logger() << F("[EWC CS]: change WiFi mode to AP_STA") << endl;
-          WiFi.mode(WIFI_AP_STA);
-          _startAP();
-        }
-        else if (_msConfigPortalTimeout > 0 && millis() - _msConfigPortalStart > _msConfigPortalTimeout)
-        {
-          if (_softAPClientCount <= 0)
-          {
-            _ap_disabled_after_timeout = true;
-            if (WiFi.SSID().length() == 0)
-            {
-              I::get().logger() << F("✘ [EWC CS]: config portal timeout: disable WiFi, since no valid SSID available") << endl;
-              WiFi.mode(WIFI_OFF);
-              _led.stop();
-            }
-            else
-            {
-              I::get().logger() << F("✘ [EWC CS]: config portal timeout: disable AP") << endl;
-              WiFi.mode(WIFI_STA);
-              _led.start(LED_GREEN, 1000, 250);
-            }
-          }
-        }
-      }
+      I::get().logger() << F("✘ [EWC CS]: config portal timeout: disable WiFi, since no valid SSID available") << endl;
+      WiFi.mode(WIFI_OFF);
+      _led.stop();
     }
     else
     {
-      if (!_connected_wifi)
+      I::get().logger() << F("✘ [EWC CS]: config portal timeout: disable AP") << endl;
+      WiFi.mode(WIFI_STA);
+      if (WiFi.status() != WL_CONNECTED)
       {
-        _connected_wifi = true;
-        _reconnectTs = 0;
-        I::get().logger() << F("[EWC CS]: connected IP: ") << WiFi.localIP().toString() << endl;
-        // Stop LED
-        _led.stop();
+        _led.start(LED_GREEN, 1000, 250);
       }
     }
   }
+  if (actions & WiFiStateMachine::ACT_CONNECTED)
+  {
+    I::get().logger() << F("[EWC CS]: connected IP: ") << WiFi.localIP().toString() << endl;
+    _bootTimeline.connected(_version);
+    _fastConnect = false;
+    _roaming.reset();
+    if (_config.paramNetworks.count() == 0 && !WiFi.SSID().isEmpty())
+    {
+      // take over the network saved by the WiFi library
+      _config.paramNetworks.add(WiFi.SSID(), WiFi.psk());
+      _configFS.save(_config);
+    }
+    if (_wifiCacheEnabled)
+    {
+      _wifiCache.update(WiFi.SSID(), _wifiCacheLease && !_config.paramStaIP);
+    }
+    // Stop LED
+    _led.stop();
+  }
 }
 
 void ConfigServer::setBrand(const char *brand, const char *version)
@@ -946,39 +1179,248 @@ void ConfigServer::sendContentP(WebServer *webServer, const String &contentType,
   _sendContentNoAuthP(webServer, contentType, content);
 }
 
-void ConfigServer::sendContentG(WebServer *webServer, const String &contentType, const uint8_t *content, size_t len)
+void ConfigServer::sendContentG(WebServer *webServer, const String &contentType, const uint8_t *content, size_t len, PGM_P etag)
+{
+  if (!isAuthenticated(webServer))
+  {
+    return webServer->requestAuthentication();
+  }
+  _sendContentNoAuthG(webServer, contentType, content, len, etag);
+}
+
+/** The length is measured before, so the document is serialized directly to the client without String buffer. **/
+void ConfigServer::sendJson(WebServer *webServer, JsonVariantConst json, int code)
+{
+  ResponseWriter writer(webServer);
+  writer.begin(code, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), measureJson(json));
+  serializeJson(json, writer);
+  writer.end();
+}
+
+void ConfigServer::addJsonProducer(const char *name, const char *uri, JsonProducerFunction producer, bool cacheable, JsonVersionFunction version)
+{
+  _jsonProducers.push_back({name, uri, producer, cacheable, version});
+  _server.on(uri, std::bind(&ConfigServer::_onJsonProducer, this, &_server, _jsonProducers.size() - 1));
+}
+
+void ConfigServer::_onJsonProducer(WebServer *webServer, size_t index)
+{
+  if (!isAuthenticated(webServer))
+  {
+    return webServer->requestAuthentication();
+  }
+  // the documents are dynamic, the browser has to validate a stored response
+  webServer->sendHeader("Cache-Control", "no-cache");
+  if (_jsonProducers[index].version)
+  {
+    char etag[16];
+    snprintf(etag, sizeof(etag), "W/\"%08lx\"", (unsigned long)_jsonProducers[index].version());
+    webServer->sendHeader("ETag", etag);
+    if (webServer->hasHeader("If-None-Match") && strstr(webServer->header("If-None-Match").c_str(), etag) != nullptr)
+    {
+      webServer->send(304);
+      return;
+    }
+  }
+  EWC_PROFILE_SCOPE("cs.json");
+  JsonDocument jsonDoc;
+  const ResponseCache::Entry *entry = _produceJson(index, jsonDoc);
+  if (entry == nullptr)
+  {
+    sendJson(webServer, jsonDoc);
+    return;
+  }
+  webServer->setContentLength(entry->len);
+  webServer->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), "");
+  webServer->sendContent(entry->data, entry->len);
+}
+
+/** Returns the serialized document from cache if the producer is cacheable.
+ * Otherwise, or if the document exceeds the cache budget, the document is filled by the producer and nullptr returned. **/
+const ResponseCache::Entry *ConfigServer::_produceJson(size_t index, JsonDocument &jsonDoc)
+{
+  JsonProducer &producer = _jsonProducers[index];
+  if (!producer.cacheable)
+  {
+    producer.producer(jsonDoc);
+    return nullptr;
+  }
+  const ResponseCache::Entry *entry = _responseCache.get(index, _configFS.generation());
+  if (entry == nullptr)
+  {
+    producer.producer(jsonDoc);
+    entry = _responseCache.put(index, _configFS.generation(), jsonDoc);
+  }
+  return entry;
+}
+
+#ifdef EWC_PROFILE
+void ConfigServer::_fillProfile(JsonDocument &jsonDoc)
+{
+  uint32_t tpu = Profiler::ticksPerUs();
+  JsonArray scopes = jsonDoc["scopes"].to<JsonArray>();
+  for (uint8_t i = 0; i < Profiler::count(); i++)
+  {
+    const Profiler::Scope &scope = Profiler::scope(i);
+    JsonObject jsonScope = scopes.add<JsonObject>();
+    jsonScope["name"] = scope.name;
+    jsonScope["count"] = scope.ticks.count();
+    jsonScope["min_us"] = scope.ticks.min() / tpu;
+    jsonScope["avg_us"] = scope.ticks.avg() / tpu;
+    jsonScope["max_us"] = scope.ticks.max() / tpu;
+    jsonScope["p99_us"] = scope.ticks.percentile(99) / tpu;
+  }
+}
+#endif
+
+void ConfigServer::_onMetrics(WebServer *webServer)
 {
   if (!isAuthenticated(webServer))
   {
     return webServer->requestAuthentication();
   }
-  _sendContentNoAuthG(webServer, contentType, content, len);
+  ResponseWriter writer(webServer);
+  writer.begin(200, F("text/plain; version=0.0.4"));
+  _metrics.write(writer);
+  writer.end();
 }
 
-void ConfigServer::sendPageSuccess(WebServer *webServer, String title, String summary, String urlBack, String details, String nameBack, String urlForward, String nameForward)
+/** Answers /ewc/batch.json?r=name1,/uri2,... with one object containing the result of each requested producer
+ * by the requested key. Unknown keys are reported as null, so the client can request them separately.
+ * The producers are called one after the other and each document is released after it was written. **/
+void ConfigServer::_onBatch(WebServer *webServer)
 {
-  String result(FPSTR(HTML_EWC_SUCCESS));
-  result.replace("{{TITLE}}", title);
-  result.replace("{{SUMMARY}}", summary);
-  result.replace("{{DETAILS}}", details);
-  result.replace("{{BACK}}", urlBack);
-  result.replace("{{BACK_NAME}}", nameBack);
-  result.replace("{{FORWARD}}", urlForward);
-  result.replace("{{FWD_NAME}}", nameForward);
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_TEXT_HTML), result);
+  if (!isAuthenticated(webServer))
+  {
+    return webServer->requestAuthentication();
+  }
+  String keys = webServer->arg("r");
+  webServer->sendHeader("Cache-Control", "no-cache");
+  ResponseWriter writer(webServer);
+  writer.begin(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON));
+  writer.print('{');
+  int start = 0;
+  bool first = true;
+  while (start < (int)keys.length())
+  {
+    int end = keys.indexOf(',', start);
+    if (end < 0)
+    {
+      end = keys.length();
+    }
+    String key = keys.substring(start, end);
+    start = end + 1;
+    if (key.isEmpty())
+    {
+      continue;
+    }
+    if (!first)
+    {
+      writer.print(',');
+    }
+    first = false;
+    _printJsonString(writer, key);
+    writer.print(':');
+    int index = _findJsonProducer(key);
+    if (index < 0)
+    {
+      writer.print(F("null"));
+      continue;
+    }
+    JsonDocument jsonDoc;
+    const ResponseCache::Entry *entry = _produceJson(index, jsonDoc);
+    if (entry == nullptr)
+    {
+      serializeJson(jsonDoc, writer);
+    }
+    else
+    {
+      writer.write(reinterpret_cast<const uint8_t *>(entry->data), entry->len);
+    }
+  }
+  writer.print('}');
+  writer.end();
 }
 
-void ConfigServer::sendPageFailed(WebServer *webServer, String title, String summary, String urlBack, String details, String nameBack, String urlForward, String nameForward)
+int ConfigServer::_findJsonProducer(const String &key)
 {
-  String result(FPSTR(HTML_EWC_FAIL));
-  result.replace("{{TITLE}}", title);
-  result.replace("{{SUMMARY}}", summary);
-  result.replace("{{DETAILS}}", details);
-  result.replace("{{BACK}}", urlBack);
-  result.replace("{{BACK_NAME}}", nameBack);
-  result.replace("{{FORWARD}}", urlForward);
-  result.replace("{{FWD_NAME}}", nameForward);
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_TEXT_HTML), result);
+  for (size_t i = 0; i < _jsonProducers.size(); i++)
+  {
+    if (key.equals(_jsonProducers[i].name) || key.equals(_jsonProducers[i].uri))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void ConfigServer::sendPageSuccess(WebServer *webServer, const String &title, const String &summary, const String &urlBack, const String &details, const String &nameBack, const String &urlForward, const String &nameForward)
+{
+  _sendPage(webServer, HTML_EWC_SUCCESS, title, summary, urlBack, details, JsonVariantConst(), nameBack, urlForward, nameForward);
+}
+
+void ConfigServer::sendPageSuccessJson(WebServer *webServer, const String &title, const String &summary, const String &urlBack, JsonVariantConst details, const String &nameBack, const String &urlForward, const String &nameForward)
+{
+  _sendPage(webServer, HTML_EWC_SUCCESS, title, summary, urlBack, String(), details, nameBack, urlForward, nameForward);
+}
+
+void ConfigServer::sendPageFailed(WebServer *webServer, const String &title, const String &summary, const String &urlBack, const String &details, const String &nameBack, const String &urlForward, const String &nameForward)
+{
+  _sendPage(webServer, HTML_EWC_FAIL, title, summary, urlBack, details, JsonVariantConst(), nameBack, urlForward, nameForward);
+}
+
+/** Streams the result page with chunked transfer encoding, neither the page nor the details are copied into the heap. **/
+void ConfigServer::_sendPage(WebServer *webServer, PGM_P page, const String &title, const String &summary, const String &urlBack, const String &details, JsonVariantConst detailsJson, const String &nameBack, const String &urlForward, const String &nameForward)
+{
+  EWC_PROFILE_SCOPE("cs.page");
+  ResponseWriter writer(webServer);
+  writer.begin(200, FPSTR(PROGMEM_CONFIG_TEXT_HTML));
+  PageTemplate(page).render(writer, [&](const char *token, ResponseWriter &out)
+  {
+    if (strcmp_P(token, PSTR("TITLE")) == 0)
+    {
+      out.print(title);
+    }
+    else if (strcmp_P(token, PSTR("SUMMARY")) == 0)
+    {
+      out.print(summary);
+    }
+    else if (strcmp_P(token, PSTR("DETAILS")) == 0)
+    {
+      if (detailsJson.isNull())
+      {
+        out.print(details);
+      }
+      else
+      {
+        out.print(F("<pre id=\"json\">"));
+        serializeJsonPretty(detailsJson, out);
+        out.print(F("</pre>"));
+      }
+    }
+    else if (strcmp_P(token, PSTR("BACK")) == 0)
+    {
+      out.print(urlBack);
+    }
+    else if (strcmp_P(token, PSTR("BACK_NAME")) == 0)
+    {
+      out.print(nameBack);
+    }
+    else if (strcmp_P(token, PSTR("FORWARD")) == 0)
+    {
+      out.print(urlForward);
+    }
+    else if (strcmp_P(token, PSTR("FWD_NAME")) == 0)
+    {
+      out.print(nameForward);
+    }
+    else
+    {
+      return false;
+    }
+    return true;
+  });
+  writer.end();
 }
 
 void ConfigServer::sendRedirect(WebServer *webServer, String url)
@@ -1004,43 +1446,65 @@ void ConfigServer::_sendFileContent(WebServer *webServer, const String &contentT
   _onNotFound(webServer);
 }
 
-void ConfigServer::_sendContentNoAuthP(WebServer *webServer, const String &contentType, PGM_P content)
+/** Serves the stored configuration as JSON: the whole document is loaded by ConfigFS::load() and then serialized to the client. **/
+void ConfigServer::_onConfigJson(WebServer *webServer)
 {
-  if (ESP.getFreeHeap() <= strlen_P(content))
+  if (!isAuthenticated(webServer))
   {
-    I::get().logger() << F("✘ [EWC CS]: Not enough memory to reply request ") << webServer->uri() << F("; free: ") << ESP.getFreeHeap() << F(", needed: ") << strlen_P(content) << endl;
-    webServer->send(200, "text/plain", F("Not enough memory"));
+    return webServer->requestAuthentication();
   }
-  else
+  JsonDocument jsonDoc;
+  // served without passwords, the route is public unless authentication is enabled
+  if (!_configFS.load(jsonDoc, false))
   {
-    webServer->send(200, contentType.c_str(), content);
+    return _onNotFound(webServer);
   }
+  sendJson(webServer, jsonDoc);
 }
 
-void ConfigServer::_sendContentNoAuthG(WebServer *webServer, const String &contentType, const uint8_t *content, size_t len)
+void ConfigServer::_sendContentNoAuthP(WebServer *webServer, const String &contentType, PGM_P content)
 {
-  I::get().logger() << F("[EWC CS]: send content for ") << webServer->uri() << F("; free: ") << ESP.getFreeHeap() << F(", needed: ") << len << endl;
-  if (ESP.getFreeHeap() <= 4000)
+  _streamContentP(webServer, contentType, content, strlen_P(content));
+}
+
+void ConfigServer::_sendContentNoAuthG(WebServer *webServer, const String &contentType, const uint8_t *content, size_t len, PGM_P etag)
+{
+  if (etag != nullptr)
   {
-    I::get().logger() << F("✘ [EWC CS]: Not enough memory to reply request ") << webServer->uri() << F("; free: ") << ESP.getFreeHeap() << F(", needed: ") << len << endl;
-    sendRedirect(webServer, webServer->uri());
-    webServer->send(406, "text/plain", F("Not enough memory"));
+    webServer->sendHeader("ETag", FPSTR(etag));
+    webServer->sendHeader("Cache-Control", F(EWC_ASSET_CACHE_CONTROL));
+    if (_isNotModified(webServer, etag))
+    {
+      webServer->send(304);
+      return;
+    }
   }
-  else
+  I::get().logger() << F("[EWC CS]: send content for ") << webServer->uri() << F("; free: ") << ESP.getFreeHeap() << F(", size: ") << len << endl;
+  webServer->sendHeader("Content-Encoding", "gzip");
+  webServer->sendHeader("Content-Disposition", "inline");
+  _streamContentP(webServer, contentType, reinterpret_cast<PGM_P>(content), len);
+}
+
+/** Sends the header with content length and writes the content directly from flash to the client.
+ * The content is never copied into the heap, so the memory needed to reply does not depend on the size of the content. **/
+void ConfigServer::_streamContentP(WebServer *webServer, const String &contentType, PGM_P content, size_t len)
+{
+  ResponseWriter writer(webServer);
+  size_t sent = writer.sendP(200, contentType, content, len);
+  if (sent < len)
   {
-    I::get().logger() << F("content type: ") << contentType << endl;
-    webServer->sendHeader("Content-Encoding", "gzip");
-    webServer->sendHeader("Content-Disposition", "inline");
-#ifdef ESP8266
-    webServer->send(200, contentType.c_str(), content, len);
-#else
-    webServer->send(200, contentType.c_str(), String(content, len));
-#endif
+    I::get().logger() << F("✘ [EWC CS]: client disconnected while sending ") << webServer->uri() << F("; sent: ") << sent << F(" of ") << len << endl;
   }
 }
 
 void ConfigServer::_onNotFound(WebServer *webServer)
 {
+  // scanners and probes would fill the route slots of the metrics
+  _metrics.requestUnrouted();
+  if (isAP() && _probeHandler->handleHost(*webServer))
+  { // probe to a known host with an unknown path, answered without logging
+    return;
+  }
   I::get().logger() << F("[EWC CS]: Handle not found") << endl;
   if (_captivePortal(webServer))
   { // If captive portal redirect instead of displaying the error page.
@@ -1076,10 +1540,22 @@ void ConfigServer::_onDeviceReset(WebServer *webServer)
 void ConfigServer::_onDeviceRestart(WebServer *webServer)
 {
   I::get().logger() << F("[EWC CS]: restart by user request") << endl;
+  _configFS.flush();
   sendRedirect(webServer, "/");
   ESP.restart();
 }
 
+/** Returns true if the client sent an If-None-Match header containing the given (PROGMEM) ETag. **/
+bool ConfigServer::_isNotModified(WebServer *webServer, PGM_P etag)
+{
+  if (!webServer->hasHeader("If-None-Match"))
+  {
+    return false;
+  }
+  String ifNoneMatch = webServer->header("If-None-Match");
+  return strstr_P(ifNoneMatch.c_str(), etag) != nullptr;
+}
+
 /** Redirect to captive portal if we got a request for another domain. Return true in that case so the page handler do not try to handle the request again. */
 bool ConfigServer::_captivePortal(WebServer *webServer)
 {
@@ -1097,16 +1573,61 @@ bool ConfigServer::_captivePortal(WebServer *webServer)
 
 void ConfigServer::_startWiFiScan(bool force)
 {
-  if (force || millis() - _msWifiScanStart > WIFI_SCAN_DELAY)
+  _scanScheduler.request(millis(), force);
+}
+
+void ConfigServer::_scanLoop()
+{
+  if (_scanScheduler.scanning())
+  {
+    if (WiFi.scanComplete() == WIFI_SCAN_RUNNING && !_scanScheduler.timedOut(millis()))
+    {
+      return;
+    }
+    _scanCache.update(_scanScheduler.channel(), _scanScheduler.lastOfSweep());
+    _scanScheduler.finished(millis());
+  }
+  int8_t channel = _scanScheduler.next(millis(), _softAPClientCount > 0);
+  if (channel == ScanScheduler::NO_SCAN)
+  {
+    return;
+  }
+  EWC_PROFILE_SCOPE("cs.scan");
+#ifdef ESP8266
+  WiFi.scanNetworks(true, true, channel);
+#else
+  if (channel == ScanScheduler::ALL_CHANNELS)
   {
     WiFi.scanNetworks(true, true);
-    _msWifiScanStart = millis();
   }
+  else
+  {
+    WiFi.scanNetworks(true, true, false, EWC_SCAN_CHANNEL_DWELL_MS, channel);
+  }
+#endif
 }
 
 bool ConfigServer::isAuthenticated(WebServer *webServer)
 {
-  return !(_config.paramBasicAuth && !webServer->authenticate(_config.paramHttpUser.c_str(), _config.paramHttpPassword.c_str()));
+  if (!_config.paramBasicAuth)
+  {
+    return true;
+  }
+  EWC_PROFILE_SCOPE("cs.auth");
+  if (_sessions.check(webServer->header("Cookie").c_str(), millis()))
+  {
+    return true;
+  }
+  if (!webServer->authenticate(_config.paramHttpUser.c_str(), _config.paramHttpPassword.c_str()))
+  {
+    return false;
+  }
+  char value[SessionStore::VALUE_SIZE];
+  _sessions.create(millis(), value);
+  char cookie[sizeof(EWC_SESSION_COOKIE) + SessionStore::VALUE_SIZE + 40];
+  snprintf_P(cookie, sizeof(cookie), PSTR(EWC_SESSION_COOKIE "=%s; Path=/; HttpOnly; SameSite=Strict"), value);
+  webServer->sendHeader("Set-Cookie", cookie);
+  return true;
 }
 
 /** Is this an IP? */
@@ -29,15 +29,35 @@ limitations under the License.
 #include <WiFi.h>
 #include <WebServer.h>
 #endif
+#include <ArduinoJson.h>
 typedef std::function<void()> WebServerHandlerFunction;
+typedef std::function<void(JsonDocument &)> JsonProducerFunction;
+typedef std::function<uint32_t()> JsonVersionFunction;
+
+/** Cache-Control sent together with the ETag of the generated web assets. **/
+#ifndef EWC_ASSET_CACHE_CONTROL
+#define EWC_ASSET_CACHE_CONTROL "public, max-age=86400"
+#endif
 
 #include <DNSServer.h>
+#include <atomic>
 #include "extensions/ewcTime.h"
 #include "ewcConfigFS.h"
 #include "ewcLogger.h"
 #include "ewcConfig.h"
 #include "ewcLed.h"
 #include "ewcInterface.h"
+#include "ewcAssetManifest.h"
+#include "ewcResponseWriter.h"
+#include "ewcResponseCache.h"
+#include "ewcMetrics.h"
+#include "ewcBootTimeline.h"
+#include "ewcWiFiCache.h"
+#include "ewcWiFiStateMachine.h"
+#include "ewcScanCache.h"
+#include "ewcScanScheduler.h"
+#include "ewcRoaming.h"
+#include "ewcSessionStore.h"
 
 namespace EWC
 {
@@ -46,6 +66,7 @@ namespace EWC
   const char PROGMEM_CONFIG_APPLICATION_JSON[] PROGMEM = "application/json; charset=utf-8";
   const char PROGMEM_CONFIG_TEXT_HTML[] PROGMEM = "text/html; charset=utf-8";
   const char PROGMEM_CONFIG_TEXT_CSS[] PROGMEM = "text/css; charset=utf-8";
+  const char PROGMEM_CONFIG_IMAGE_SVG[] PROGMEM = "image/svg+xml";
 
   struct MenuItem
   {
@@ -70,8 +91,12 @@ namespace EWC
     EWC_STATION_NO_SHIELD        // ESP32
   } wifi_status_t;
 
+  class ProbeHandler;
+
   class ConfigServer
   {
+    friend class AssetHandler;
+
   public:
     ConfigServer(uint16_t port = 80);
     /** Add your own pages to menu.
@@ -81,23 +106,50 @@ namespace EWC
      * @param visible: true, if menu item is visible
      * @param position: use negative or positive value to shift this menu item on insert. It is only relative to previous inserted items.
      * @param onRequest: callback on menu item
-     * @param content: send content on menu item **/
+     * @param content: send content on menu item
+     * @param etag: optional ETag of the content (generated as <NAME>_ETAG), enables conditional requests **/
     void insertMenu(const char *name, const char *uri, const char *entry_id, bool visible = true, int position = 255);
     void insertMenuCb(const char *name, const char *uri, const char *entry_id, WebServerHandlerFunction onRequest, bool visible = true, int position = 255);
     void insertMenuP(const char *name, const char *uri, const char *entry_id, const String &contentType, PGM_P content, bool visible = true, int position = 255);
-    void insertMenuG(const char *name, const char *uri, const char *entry_id, const String &contentType, const uint8_t *content, size_t len, bool visible = true, int position = 255);
+    void insertMenuG(const char *name, const char *uri, const char *entry_id, const String &contentType, const uint8_t *content, size_t len, bool visible = true, int position = 255, PGM_P etag = nullptr);
     void insertMenuNoAuthP(const char *name, const char *uri, const char *entry_id, const String &contentType, PGM_P content, bool visible = true, int position = 255);
-    void insertMenuNoAuthG(const char *name, const char *uri, const char *entry_id, const String &contentType, const uint8_t *content, size_t len, bool visible = true, int position = 255);
+    void insertMenuNoAuthG(const char *name, const char *uri, const char *entry_id, const String &contentType, const uint8_t *content, size_t len, bool visible = true, int position = 255, PGM_P etag = nullptr);
+    /** Adds a menu item for a page of the generated asset manifests and enables the asset. **/
+    void insertMenuA(const char *name, const char *uri, const char *entry_id, bool visible = true, int position = 255);
+    /** Registers a manifest generated by scripts/generate_headers.py, e.g. APP_ASSETS from "generated/appAssets.h".
+     * All files of the web folder are then served by one handler. CSS, JS and SVG files are enabled by default,
+     * pages and JSON files must be enabled by enableAsset() or insertMenuA(). Manifests added later override previous. **/
+    void addAssets(AssetTable &table);
+    /** Enables the generated asset with given uri. Returns false if the uri is not in a registered manifest. **/
+    bool enableAsset(const char *uri, bool noAuth = false);
     /** Grands access to configuration under "/ewc/config". The result is a JSON object.
      * Call enableConfigUri() before setup to enabled access. **/
     void enableConfigUri() { _publicConfig = true; }
+    /** Connect with BSSID and channel of the last connection to skip the scan (default enabled).
+     * With lease the last IP configuration from DHCP is used as static configuration.
+     * After a failed attempt a full scan with DHCP is done. Call before setup(). **/
+    void setWiFiCache(bool enabled, bool lease = false)
+    {
+      _wifiCacheEnabled = enabled;
+      _wifiCacheLease = lease;
+    }
     /** The configuration portal (AP) will be disabled after (Default: 5 Minutes).
      * You can increase the timeout with setTimeoutPortal() or disable the shutdown
      * of AP with disablePortalTimeout(). **/
     void disablePortalTimeout() { setTimeoutPortal(0); }
-    void setTimeoutPortal(uint32_t seconds) { _msConfigPortalTimeout = seconds * 1000; }
+    void setTimeoutPortal(uint32_t seconds) { _wifiState.setPortalTimeout(seconds * 1000); }
     /** After connect timeout a configuration portal will be open. **/
-    void setTimeoutConnect(uint32_t seconds) { _msConnectTimeout = seconds * 1000; }
+    void setTimeoutConnect(uint32_t seconds) { _wifiState.setConnectTimeout(seconds * 1000); }
+    /** Delay of the WiFi reconnect, doubled after each failed attempt up to maxSeconds. **/
+    void setReconnectBackoff(uint32_t minSeconds, uint32_t maxSeconds) { _wifiState.setBackoff(minSeconds * 1000, maxSeconds * 1000); }
+    /** Enables the roaming to a stronger access point of the same SSID: if the average RSSI falls below threshold (dBm)
+     * a scan is started at most every scanIntervalSeconds, another access point must be better by hysteresis (dB). **/
+    void setRoaming(bool enabled, int8_t threshold = EWC_ROAMING_THRESHOLD, uint8_t hysteresis = EWC_ROAMING_HYSTERESIS, uint32_t scanIntervalSeconds = EWC_ROAMING_SCAN_INTERVAL_MS / 1000)
+    {
+      _roamingEnabled = enabled;
+      _roaming.configure(threshold, hysteresis, scanIntervalSeconds * 1000);
+      _roaming.reset();
+    }
     /** Sets brand and version of the firmware.
      * Brand is description on the left side in the menu. **/
     void setBrand(const char *brand, const char *version = "not-set");
@@ -121,16 +173,31 @@ namespace EWC
     Config &config() { return _config; }
     Led &led() { return _led; }
     WebServer &webServer() { return _server; }
-    /** Sends content to the client. The authentication is carried out before send depending on the configuration. **/
+    /** Sends content to the client. The authentication is carried out before send depending on the configuration.
+     * If an ETag is given, the gzip content is sent with ETag and Cache-Control header and
+     * a request with matching If-None-Match header is answered with 304 without body. **/
     void sendContentP(WebServer *request, const String &contentType, PGM_P content);
-    void sendContentG(WebServer *request, const String &contentType, const uint8_t *content, size_t len);
+    void sendContentG(WebServer *request, const String &contentType, const uint8_t *content, size_t len, PGM_P etag = nullptr);
+    /** Sends the JSON document with Content-Length. It is serialized directly to the client without String copy. **/
+    void sendJson(WebServer *request, JsonVariantConst json, int code = 200);
+    /** Registers a producer which fills a JSON document. The document is served on given uri and
+     * can be combined with other documents in one request: /ewc/batch.json?r=name1,name2 or by uri ?r=/uri1,/uri2
+     * Set cacheable only if the document depends on the configuration or menu only.
+     * If a version function is given, the single response gets a weak ETag with this version and
+     * a request with matching If-None-Match is answered by 304 without calling the producer. **/
+    void addJsonProducer(const char *name, const char *uri, JsonProducerFunction producer, bool cacheable = false, JsonVersionFunction version = nullptr);
+    /** Cache of producers registered as cacheable. Their response is kept until the configuration is saved or the menu changed. **/
+    ResponseCache &responseCache() { return _responseCache; }
     /** Creates a page with successful result.**/
-    void sendPageSuccess(WebServer *request, String title, String summary, String urlBack, String details = "", String nameBack = "Back", String urlForward = "/", String nameForward = "Home");
+    void sendPageSuccess(WebServer *request, const String &title, const String &summary, const String &urlBack, const String &details = "", const String &nameBack = "Back", const String &urlForward = "/", const String &nameForward = "Home");
+    /** Creates a page with successful result, the JSON details are written pretty formatted into a pre block. **/
+    void sendPageSuccessJson(WebServer *request, const String &title, const String &summary, const String &urlBack, JsonVariantConst details, const String &nameBack = "Back", const String &urlForward = "/", const String &nameForward = "Home");
     /** Creates a page with failed result. **/
-    void sendPageFailed(WebServer *request, String title, String summary, String urlBack, String details = "", String nameBack = "Back", String urlForward = "/", String nameForward = "Home");
+    void sendPageFailed(WebServer *request, const String &title, const String &summary, const String &urlBack, const String &details = "", const String &nameBack = "Back", const String &urlForward = "/", const String &nameForward = "Home");
     /** Send header with redirect to given url. **/
     void sendRedirect(WebServer *request, String url);
-    /** Returns true if the client is authenticated. **/
+    /** Returns true if the client is authenticated. After a successful Basic authentication a session cookie is set,
+     * the following requests with this cookie are authenticated without checking the Authorization header. **/
     bool isAuthenticated(WebServer *request);
 
   protected:
@@ -141,57 +208,121 @@ namespace EWC
     Led _led;
     Time _time;
     Config _config;
+    Metrics _metrics;
+    BootTimeline _bootTimeline;
     String _brand;
     String _version;
     String _brandUri;
     std::vector<MenuItem> _menu;
+    struct JsonProducer
+    {
+      String name;
+      String uri;
+      JsonProducerFunction producer;
+      bool cacheable;
+      JsonVersionFunction version;
+    };
+    std::vector<JsonProducer> _jsonProducers;
+    ResponseCache _responseCache;
+    std::vector<AssetTable *> _assetTables;
+    ProbeHandler *_probeHandler;
     IPAddress _ap_address;
     static PGM_P wlStatusSymbols[];
     bool _publicConfig;
-    bool _connected_wifi;
-    bool _ap_disabled_after_timeout; //< once disabled the portal will open only after reboot or error after successful connect
-    int _softAPClientCount;          //< do not disabled Config Portal if one is connected
+    std::atomic<int> _softAPClientCount; //< do not disabled Config Portal if one is connected
     uint8_t _disconnect_state;
     String _disconnect_reason;
 
     unsigned long _msConnectStart = 0;
-    unsigned long _msWifiScanStart = 0;
-    unsigned long _msConfigPortalStart = 0;
-    unsigned long _msConfigPortalTimeout = 300000;
-    unsigned long _msConnectTimeout = 60000;
-    unsigned long _reconnectTs = 0;
+    ScanCache _scanCache;
+    ScanScheduler _scanScheduler;
+    WiFiStateMachine _wifiState;
+    SessionStore _sessions;
+    uint8_t _wifiActions = 0; //< actions of the state machine set by WiFi events, executed in loop()
+    /** Bits of the WiFi events queued by the callbacks, see _wifiEventLoop(). **/
+    enum WiFiEventBits : uint32_t
+    {
+      WIFI_EVENT_STA_CONNECTED = 1,
+      WIFI_EVENT_STA_DISCONNECTED = 2,
+      WIFI_EVENT_AP_STA_DISCONNECTED = 4
+    };
+    std::atomic<uint32_t> _wifiEvents{0};
+    volatile uint8_t _wifiEventReason = 0; //< reason of the last queued disconnect
+    WiFiCache _wifiCache;
+    bool _wifiCacheEnabled = true;
+    bool _wifiCacheLease = false;
+    bool _fastConnect = false; //< true while connecting with the cached parameter
+    std::vector<uint8_t> _candidates; //< indexes of known networks ranked by RSSI for the current connect round
+    size_t _candidateIndex = 0;
+    bool _wifiRetry = false; //< true if the next connect continues the current round
+    Roaming _roaming;
+    bool _roamingEnabled = false;
+    unsigned long _roamingSampleTs = 0;
+    uint32_t _roamingGeneration = 0; //< generation of the scan cache when the roaming scan was started
 
     // IPAddress _ap_static_ip;
     // IPAddress _ap_static_gw;
     // IPAddress _ap_static_sn;
-    IPAddress _sta_static_ip;
-    IPAddress _sta_static_gw;
-    IPAddress _sta_static_sn;
-    IPAddress _sta_static_dns1 = (uint32_t)0x00000000;
-    IPAddress _sta_static_dns2 = (uint32_t)0x00000000;
 
     // DNS server
     const byte DNS_PORT = 53;
 
     bool _captivePortal(WebServer *request);
+    bool _isNotModified(WebServer *request, PGM_P etag);
     void _connect(const char *ssid = nullptr, const char *pass = nullptr);
+    void _fastConnectFailed();
+    /** Ranks the known networks by the last scan results and starts with the best one. **/
+    void _startRound();
+    /** Tries the next known network or reports the disconnect with the reason code of the WiFi library to the state machine. **/
+    void _wifiDisconnected(uint8_t reason);
+    void _queueDisconnect(uint8_t reason);
+    void _wifiEventLoop();
+    void _staDisconnected(uint8_t reason);
+    /** Samples the RSSI while connected and evaluates the roaming scans. **/
+    void _roamingLoop();
+    void _fillWifiNetworks(JsonDocument &jsonDoc);
+    void _onWiFiNetworkRemove(WebServer *request);
+    void _wifiExecute(uint8_t actions);
+    void _fillWifiTrace(JsonDocument &jsonDoc);
+    /** Parses the static IP configuration of the WiFi setup form, sets ip to 0 if dhcp is selected or the value is invalid. **/
+    void _staticIPFromArg(WebServer *request, const char *name, bool dhcp, IPAddress &ip);
     void _startAP();
+    /** Requests a scan sweep, executed by _scanLoop(). **/
     void _startWiFiScan(bool force = false);
+    /** Starts the scans returned by the scheduler and merges their results into the scan cache. **/
+    void _scanLoop();
     /** === web handler === **/
     String _token_WIFI_MODE();
-    void _sendMenu(WebServer *request);
+    void _fillMenu(JsonDocument &jsonDoc);
+    void _onJsonProducer(WebServer *request, size_t index);
+    void _onBatch(WebServer *request);
+    void _onMetrics(WebServer *request);
+#ifdef EWC_PROFILE
+    unsigned long _profileReportTs = 0;
+    void _fillProfile(JsonDocument &jsonDoc);
+#endif
+    int _findJsonProducer(const String &key);
+    const ResponseCache::Entry *_produceJson(size_t index, JsonDocument &jsonDoc);
     void _sendFileContent(WebServer *request, const String &contentType, const String &filename);
+    void _onConfigJson(WebServer *request);
     void _sendContentNoAuthP(WebServer *request, const String &contentType, PGM_P content);
-    void _sendContentNoAuthG(WebServer *request, const String &contentType, const uint8_t *content, size_t len);
-    void _onAccessGet(WebServer *request);
+    void _sendContentNoAuthG(WebServer *request, const String &contentType, const uint8_t *content, size_t len, PGM_P etag = nullptr);
+    void _streamContentP(WebServer *request, const String &contentType, PGM_P content, size_t len);
+    void _sendPage(WebServer *request, PGM_P page, const String &title, const String &summary, const String &urlBack, const String &details, JsonVariantConst detailsJson, const String &nameBack, const String &urlForward, const String &nameForward);
+    bool _findAsset(const char *uri, AssetTable *&table, size_t &index);
+    void _sendAsset(WebServer *request, const AssetTable &table, size_t index);
+    bool _sendAsset(WebServer *request, const char *uri);
+    static PGM_P _assetMimeType(uint8_t mime);
+    void _fillAccess(JsonDocument &jsonDoc);
     void _onAccessSave(WebServer *request);
-    void _onGetInfo(WebServer *request);
-    void _onLoggingGet(WebServer *request);
+    void _fillInfo(JsonDocument &jsonDoc);
+    void _fillLogging(JsonDocument &jsonDoc);
     void _onLoggingEnable(WebServer *request);
     void _onWiFiConnect(WebServer *request);
     void _onWiFiDisconnect(WebServer *request);
-    void _onWifiState(WebServer *request);
-    void _onWifiScan(WebServer *request);
+    void _fillWifiState(JsonDocument &jsonDoc);
+    uint32_t _wifiStateVersion();
+    void _fillWifiScan(JsonDocument &jsonDoc);
     void _onNotFound(WebServer *request);
     void _onDeviceReset(WebServer *request);
     void _onDeviceRestart(WebServer *request);
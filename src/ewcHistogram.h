@@ -0,0 +1,124 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_HISTOGRAM_H
+#define EWC_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Count of buckets with upper bound, values above the last bound are counted in an overflow bucket. **/
+#ifndef EWC_HISTOGRAM_BUCKETS
+#define EWC_HISTOGRAM_BUCKETS 12
+#endif
+
+namespace EWC
+{
+  /** Histogram with fixed memory and power of two bucket bounds.
+   * Bucket i counts the values below 2^(i + minShift), so recording a value is a count of leading zeros
+   * and an increment, without allocation. It does not depend on Arduino and can be used on host. **/
+  template <uint8_t N>
+  class BasicHistogram
+  {
+  public:
+    static const uint8_t BUCKETS = N;
+
+    explicit BasicHistogram(uint8_t minShift = 0) : _minShift(minShift) { reset(); }
+
+    void record(uint32_t value)
+    {
+      _buckets[bucketOf(value)]++;
+      _count++;
+      _sum += value;
+      if (value > _max)
+      {
+        _max = value;
+      }
+      if (value < _min)
+      {
+        _min = value;
+      }
+    }
+
+    /** Index of the bucket for the value, N is the overflow bucket. **/
+    uint8_t bucketOf(uint32_t value) const
+    {
+      uint8_t bits = value == 0 ? 0 : 32 - __builtin_clz(value);
+      if (bits <= _minShift)
+      {
+        return 0;
+      }
+      uint8_t idx = bits - _minShift;
+      return idx < N ? idx : N;
+    }
+
+    /** Inclusive upper bound of the bucket: all counted values are lower or equal. **/
+    uint32_t upperBound(uint8_t bucket) const { return (1UL << (bucket + _minShift)) - 1; }
+    uint32_t bucket(uint8_t bucket) const { return _buckets[bucket]; }
+    uint32_t count() const { return _count; }
+    uint64_t sum() const { return _sum; }
+    uint32_t max() const { return _max; }
+    uint32_t min() const { return _count > 0 ? _min : 0; }
+    uint32_t avg() const { return _count > 0 ? _sum / _count : 0; }
+
+    /** Upper bound of the bucket containing the given percentile, limited to the maximum recorded value. **/
+    uint32_t percentile(uint8_t percent) const
+    {
+      if (_count == 0)
+      {
+        return 0;
+      }
+      uint32_t rank = ((uint64_t)_count * percent + 99) / 100;
+      uint32_t cumulative = 0;
+      for (uint8_t i = 0; i < N; i++)
+      {
+        cumulative += _buckets[i];
+        if (cumulative >= rank)
+        {
+          return upperBound(i) < _max ? upperBound(i) : _max;
+        }
+      }
+      return _max;
+    }
+
+    void reset()
+    {
+      for (uint8_t i = 0; i <= N; i++)
+      {
+        _buckets[i] = 0;
+      }
+      _count = 0;
+      _sum = 0;
+      _max = 0;
+      _min = UINT32_MAX;
+    }
+
+  protected:
+    uint32_t _buckets[N + 1];
+    uint32_t _count;
+    uint64_t _sum;
+    uint32_t _max;
+    uint32_t _min;
+    uint8_t _minShift;
+  };
+
+  typedef BasicHistogram<EWC_HISTOGRAM_BUCKETS> Histogram;
+};
+#endif
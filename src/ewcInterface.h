@@ -31,6 +31,8 @@ namespace EWC
   class ConfigFS;
   class Led;
   class Time;
+  class Metrics;
+  class BootTimeline;
 
   /** The objects of the interface are initialized by ConfigServer.
    * The interface is globally reachable through I::get(). **/
@@ -47,6 +49,8 @@ namespace EWC
     Logger &logger();
     Led &led() { return *_led; }
     Time &time() { return *_time; }
+    Metrics &metrics() { return *_metrics; }
+    BootTimeline &boot() { return *_boot; }
 
   private:
     ConfigServer *_server = nullptr;
@@ -55,6 +59,8 @@ namespace EWC
     Logger *_logger = nullptr;
     Led *_led = nullptr;
     Time *_time = nullptr;
+    Metrics *_metrics = nullptr;
+    BootTimeline *_boot = nullptr;
   };
 
   static InterfaceData *gInterfaceData = nullptr;
@@ -0,0 +1,285 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+#include "ewcMetrics.h"
+
+using namespace EWC;
+
+/** Lowest bucket bound of the request latency: 256 us, the last bucket ends at about 0.5 s. **/
+#define METRICS_REQUEST_SHIFT 8
+/** Lowest bucket bound of the loop interval: 16 us, the last bucket ends at about 32 ms. **/
+#define METRICS_LOOP_SHIFT 4
+/** The heap is sampled each second, since the largest free block walks the heap. **/
+#define METRICS_HEAP_SAMPLE_MS 1000
+
+static const char PROBE_OS_ANDROID[] PROGMEM = "android";
+static const char PROBE_OS_APPLE[] PROGMEM = "apple";
+static const char PROBE_OS_WINDOWS[] PROGMEM = "windows";
+static const char PROBE_OS_FIREFOX[] PROGMEM = "firefox";
+static PGM_P const PROBE_OS_NAMES[] = {PROBE_OS_ANDROID, PROBE_OS_APPLE, PROBE_OS_WINDOWS, PROBE_OS_FIREFOX};
+
+Metrics::Metrics()
+    : _routeCount(0),
+      _otherLatency(METRICS_REQUEST_SHIFT),
+      _loopInterval(METRICS_LOOP_SHIFT),
+      _loopLastUs(0),
+      _requestStartUs(0),
+      _requestPending(false),
+      _requestUnrouted(false),
+      _heapMin(UINT32_MAX),
+      _maxBlockMin(UINT32_MAX),
+      _heapSampleMs(0),
+      _mqttPublished(0),
+      _mqttFailed(0),
+      _wifiReconnects(0),
+      _wifiRoamScans(0),
+      _wifiRoams(0),
+      _wifiRoamStays(0),
+      _disconnectCount(0),
+      _configSaves(0),
+      _probes()
+{
+  for (uint8_t i = 0; i < EWC_METRICS_ROUTES; i++)
+  {
+    _routes[i].latency = Histogram(METRICS_REQUEST_SHIFT);
+  }
+}
+
+void Metrics::loop()
+{
+  uint32_t now = micros();
+  if (_loopLastUs != 0)
+  {
+    _loopInterval.record(now - _loopLastUs);
+  }
+  _loopLastUs = now;
+  if (millis() - _heapSampleMs >= METRICS_HEAP_SAMPLE_MS)
+  {
+    _heapSampleMs = millis();
+    uint32_t heap = ESP.getFreeHeap();
+    if (heap < _heapMin)
+    {
+      _heapMin = heap;
+    }
+    uint32_t block = _maxFreeBlock();
+    if (block < _maxBlockMin)
+    {
+      _maxBlockMin = block;
+    }
+  }
+}
+
+void Metrics::requestStarted()
+{
+  if (!_requestPending)
+  {
+    _requestPending = true;
+    _requestUnrouted = false;
+    _requestStartUs = micros();
+  }
+}
+
+bool Metrics::requestFinished(const String &uri)
+{
+  if (_requestPending)
+  {
+    _requestPending = false;
+    Histogram &latency = _requestUnrouted ? _otherLatency : _routeLatency(uri);
+    latency.record(micros() - _requestStartUs);
+    return true;
+  }
+  return false;
+}
+
+void Metrics::mqttPublished(bool success)
+{
+  if (success)
+  {
+    _mqttPublished++;
+  }
+  else
+  {
+    _mqttFailed++;
+  }
+}
+
+void Metrics::wifiDisconnected(uint8_t reason)
+{
+  for (uint8_t i = 0; i < _disconnectCount; i++)
+  {
+    if (_disconnects[i].reason == reason)
+    {
+      _disconnects[i].count++;
+      return;
+    }
+  }
+  if (_disconnectCount < EWC_METRICS_DISCONNECT_REASONS - 1)
+  {
+    _disconnects[_disconnectCount++] = {reason, 1};
+    return;
+  }
+  // table full, the last entry counts all further reasons
+  _disconnects[EWC_METRICS_DISCONNECT_REASONS - 1].reason = 0;
+  _disconnects[EWC_METRICS_DISCONNECT_REASONS - 1].count++;
+  _disconnectCount = EWC_METRICS_DISCONNECT_REASONS;
+}
+
+Histogram &Metrics::_routeLatency(const String &uri)
+{
+  for (uint8_t i = 0; i < _routeCount; i++)
+  {
+    if (_routes[i].uri.equals(uri))
+    {
+      return _routes[i].latency;
+    }
+  }
+  if (_routeCount < EWC_METRICS_ROUTES)
+  {
+    _routes[_routeCount].uri = uri;
+    return _routes[_routeCount++].latency;
+  }
+  return _otherLatency;
+}
+
+uint32_t Metrics::_maxFreeBlock()
+{
+#if defined(ESP8266)
+  return ESP.getMaxFreeBlockSize();
+#else
+  return ESP.getMaxAllocHeap();
+#endif
+}
+
+void Metrics::write(Print &out)
+{
+  out.print(F("# TYPE ewc_http_request_duration_seconds histogram\n"));
+  for (uint8_t i = 0; i < _routeCount; i++)
+  {
+    _writeHistogram(out, F("ewc_http_request_duration_seconds"), _routes[i].uri.c_str(), _routes[i].latency);
+  }
+  _writeHistogram(out, F("ewc_http_request_duration_seconds"), "other", _otherLatency);
+  out.print(F("# TYPE ewc_loop_interval_seconds histogram\n"));
+  _writeHistogram(out, F("ewc_loop_interval_seconds"), nullptr, _loopInterval);
+  _writeValue(out, F("gauge"), F("ewc_heap_free_bytes"), ESP.getFreeHeap());
+  _writeValue(out, F("gauge"), F("ewc_heap_free_min_bytes"), _heapMin == UINT32_MAX ? ESP.getFreeHeap() : _heapMin);
+  _writeValue(out, F("gauge"), F("ewc_heap_max_block_bytes"), _maxFreeBlock());
+  _writeValue(out, F("gauge"), F("ewc_heap_max_block_min_bytes"), _maxBlockMin == UINT32_MAX ? _maxFreeBlock() : _maxBlockMin);
+  _writeValue(out, F("counter"), F("ewc_mqtt_published_total"), _mqttPublished);
+  _writeValue(out, F("counter"), F("ewc_mqtt_publish_failed_total"), _mqttFailed);
+  _writeValue(out, F("counter"), F("ewc_wifi_reconnects_total"), _wifiReconnects);
+  _writeValue(out, F("counter"), F("ewc_wifi_roam_scans_total"), _wifiRoamScans);
+  _writeValue(out, F("counter"), F("ewc_wifi_roams_total"), _wifiRoams);
+  _writeValue(out, F("counter"), F("ewc_wifi_roam_stays_total"), _wifiRoamStays);
+  out.print(F("# TYPE ewc_wifi_disconnects_total counter\n"));
+  for (uint8_t i = 0; i < _disconnectCount; i++)
+  {
+    out.print(F("ewc_wifi_disconnects_total{reason=\""));
+    out.print(_disconnects[i].reason);
+    out.print(F("\"} "));
+    out.print(_disconnects[i].count);
+    out.print('\n');
+  }
+  _writeValue(out, F("counter"), F("ewc_config_saves_total"), _configSaves);
+  out.print(F("# TYPE ewc_captive_probes_total counter\n"));
+  for (uint8_t i = 0; i < PROBE_OS_COUNT; i++)
+  {
+    out.print(F("ewc_captive_probes_total{os=\""));
+    out.print(FPSTR(PROBE_OS_NAMES[i]));
+    out.print(F("\"} "));
+    out.print(_probes[i]);
+    out.print('\n');
+  }
+}
+
+void Metrics::_writeValue(Print &out, const __FlashStringHelper *type, const __FlashStringHelper *name, uint32_t value)
+{
+  out.print(F("# TYPE "));
+  out.print(name);
+  out.print(' ');
+  out.print(type);
+  out.print('\n');
+  out.print(name);
+  out.print(' ');
+  out.print(value);
+  out.print('\n');
+}
+
+/** Writes the route label, quotes and backslashes in the uri are escaped. **/
+void Metrics::_writeLabels(Print &out, const char *route, bool more)
+{
+  if (route == nullptr)
+  {
+    if (!more)
+    {
+      out.print(' ');
+    }
+    return;
+  }
+  out.print(F("{route=\""));
+  for (const char *c = route; *c != '\0'; c++)
+  {
+    if (*c == '"' || *c == '\\')
+    {
+      out.print('\\');
+    }
+    out.print(*c);
+  }
+  out.print(more ? F("\",") : F("\"} "));
+}
+
+/** Writes the cumulative buckets, sum and count of the histogram. The values are recorded in microseconds. **/
+void Metrics::_writeHistogram(Print &out, const __FlashStringHelper *name, const char *route, const Histogram &histogram)
+{
+  uint32_t cumulative = 0;
+  for (uint8_t b = 0; b <= EWC_HISTOGRAM_BUCKETS; b++)
+  {
+    cumulative += histogram.bucket(b);
+    out.print(name);
+    out.print(F("_bucket"));
+    if (route == nullptr)
+    {
+      out.print('{');
+    }
+    _writeLabels(out, route, true);
+    out.print(F("le=\""));
+    if (b < EWC_HISTOGRAM_BUCKETS)
+    {
+      out.print((histogram.upperBound(b) + 1) / 1000000.0, 6);
+    }
+    else
+    {
+      out.print(F("+Inf"));
+    }
+    out.print(F("\"} "));
+    out.print(cumulative);
+    out.print('\n');
+  }
+  out.print(name);
+  out.print(F("_sum"));
+  _writeLabels(out, route, false);
+  out.print(histogram.sum() / 1000000.0, 6);
+  out.print('\n');
+  out.print(name);
+  out.print(F("_count"));
+  _writeLabels(out, route, false);
+  out.print(histogram.count());
+  out.print('\n');
+}
@@ -0,0 +1,114 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_METRICS_H
+#define EWC_METRICS_H
+
+#include <Arduino.h>
+#include "ewcHistogram.h"
+
+/** Count of routes with own latency histogram, further routes are counted as "other". **/
+#ifndef EWC_METRICS_ROUTES
+#define EWC_METRICS_ROUTES 8
+#endif
+/** Count of different WiFi disconnect reasons counted separately, further reasons are counted as 0. **/
+#ifndef EWC_METRICS_DISCONNECT_REASONS
+#define EWC_METRICS_DISCONNECT_REASONS 8
+#endif
+
+namespace EWC
+{
+  /** Counters and histograms with fixed memory, exposed on /ewc/metrics in Prometheus text format.
+   * Recording does not allocate heap, only the first request of a registered route stores the uri of the route.
+   * Captive portal probes and not found requests are counted as "other" and do not take a route slot. **/
+  class Metrics
+  {
+  public:
+    /** Operating system of a captive portal probe. **/
+    enum ProbeOS : uint8_t
+    {
+      PROBE_ANDROID,
+      PROBE_APPLE,
+      PROBE_WINDOWS,
+      PROBE_FIREFOX,
+      PROBE_OS_COUNT
+    };
+
+    Metrics();
+    /** Called by ConfigServer on each loop: measures the interval between the calls and samples the heap. **/
+    void loop();
+    /** Called on begin of the request dispatch by the first request handler. **/
+    void requestStarted();
+    /** Called after handleClient() of the web server. Records the latency if a request was started, returns true in this case. **/
+    bool requestFinished(const String &uri);
+    /** Called by the handlers of probes and not found requests: the latency of the current request is counted as "other". **/
+    void requestUnrouted() { _requestUnrouted = true; }
+    void mqttPublished(bool success);
+    void wifiReconnect() { _wifiReconnects++; }
+    void wifiDisconnected(uint8_t reason);
+    void wifiRoamScan() { _wifiRoamScans++; }
+    /** Counts the decision after a roaming scan. **/
+    void wifiRoamDecision(bool roamed) { roamed ? _wifiRoams++ : _wifiRoamStays++; }
+    void configSaved() { _configSaves++; }
+    void captiveProbe(ProbeOS os) { _probes[os]++; }
+    /** Writes all metrics in Prometheus text format. **/
+    void write(Print &out);
+
+  protected:
+    struct Route
+    {
+      String uri;
+      Histogram latency;
+    };
+    struct Reason
+    {
+      uint8_t reason;
+      uint32_t count;
+    };
+    Route _routes[EWC_METRICS_ROUTES];
+    uint8_t _routeCount;
+    Histogram _otherLatency;
+    Histogram _loopInterval;
+    uint32_t _loopLastUs;
+    uint32_t _requestStartUs;
+    bool _requestPending;
+    bool _requestUnrouted;
+    uint32_t _heapMin;
+    uint32_t _maxBlockMin;
+    uint32_t _heapSampleMs;
+    uint32_t _mqttPublished;
+    uint32_t _mqttFailed;
+    uint32_t _wifiReconnects;
+    uint32_t _wifiRoamScans;
+    uint32_t _wifiRoams;
+    uint32_t _wifiRoamStays;
+    Reason _disconnects[EWC_METRICS_DISCONNECT_REASONS];
+    uint8_t _disconnectCount;
+    uint32_t _configSaves;
+    uint32_t _probes[PROBE_OS_COUNT];
+
+    Histogram &_routeLatency(const String &uri);
+    void _writeHistogram(Print &out, const __FlashStringHelper *name, const char *route, const Histogram &histogram);
+    void _writeLabels(Print &out, const char *route, bool more);
+    void _writeValue(Print &out, const __FlashStringHelper *type, const __FlashStringHelper *name, uint32_t value);
+    static uint32_t _maxFreeBlock();
+  };
+};
+#endif
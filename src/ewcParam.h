@@ -0,0 +1,286 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_PARAM_H
+#define EWC_PARAM_H
+
+#ifdef ESP8266
+#include <ESP8266WebServer.h>
+#define WebServer ESP8266WebServer
+#elif defined(ESP32)
+#include <WebServer.h>
+#endif
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+namespace EWC
+{
+  enum ParamType : uint8_t
+  {
+    PARAM_BOOL,
+    PARAM_INT,
+    PARAM_UINT16,
+    PARAM_STRING
+  };
+
+  /** Bits of Param::flags. **/
+  enum ParamFlag : uint8_t
+  {
+    /** Not written by toJson() with secrets = false, an empty form value keeps the stored value.
+     * The form argument <form name>_clear=true (e.g. a checkbox) clears it. **/
+    PARAM_SECRET = 1,
+    /** An empty form value keeps the stored value. **/
+    PARAM_FORM_NON_EMPTY = 2,
+    /** Checkbox: a missing form argument is false, a present one is true if its value is "true" or "on". **/
+    PARAM_FORM_CHECKBOX = 4
+  };
+
+  typedef bool (*ParamValidator)(const char *value);
+
+  /** Descriptor of one parameter of the configuration class C.
+   * The descriptors of a class are a constexpr table, see ParamTable. The member is addressed by a
+   * pointer to member, so the table needs no offsets and is checked by the compiler. **/
+  template <class C>
+  struct Param
+  {
+    union Member
+    {
+      bool C::*b;
+      int C::*i;
+      uint16_t C::*u16;
+      String C::*s;
+      constexpr Member(bool C::*m) : b(m) {}
+      constexpr Member(int C::*m) : i(m) {}
+      constexpr Member(uint16_t C::*m) : u16(m) {}
+      constexpr Member(String C::*m) : s(m) {}
+    };
+
+    const char *key;      //< key in the JSON object of the module
+    const char *formName; //< name of the form argument, nullptr if equal to key
+    ParamType type;
+    Member member;
+    uint8_t flags;
+    long defaultNumber;           //< default of bool and number parameter
+    const char *defaultString;    //< default of string parameter
+    long min;                     //< valid range of numbers, ignored if min > max
+    long max;
+    ParamValidator validator;     //< optional check of string values
+
+    constexpr Param(const char *key, const char *formName, ParamType type, Member member, uint8_t flags, long defaultNumber, const char *defaultString, long min, long max, ParamValidator validator)
+        : key(key), formName(formName), type(type), member(member), flags(flags), defaultNumber(defaultNumber), defaultString(defaultString), min(min), max(max), validator(validator) {}
+
+    const char *form() const { return formName != nullptr ? formName : key; }
+    bool valid(long value) const { return min > max || (value >= min && value <= max); }
+    bool valid(const char *value) const { return validator == nullptr || validator(value); }
+  };
+
+  template <class C>
+  constexpr Param<C> paramBool(const char *key, bool C::*member, bool defaultValue, uint8_t flags = PARAM_FORM_CHECKBOX, const char *formName = nullptr)
+  {
+    return Param<C>(key, formName, PARAM_BOOL, member, flags, defaultValue, nullptr, 1, 0, nullptr);
+  }
+
+  template <class C>
+  constexpr Param<C> paramInt(const char *key, int C::*member, int defaultValue, long min, long max, uint8_t flags = PARAM_FORM_NON_EMPTY, const char *formName = nullptr)
+  {
+    return Param<C>(key, formName, PARAM_INT, member, flags, defaultValue, nullptr, min, max, nullptr);
+  }
+
+  template <class C>
+  constexpr Param<C> paramUInt16(const char *key, uint16_t C::*member, uint16_t defaultValue, long min = 0, long max = UINT16_MAX, uint8_t flags = PARAM_FORM_NON_EMPTY, const char *formName = nullptr)
+  {
+    return Param<C>(key, formName, PARAM_UINT16, member, flags, defaultValue, nullptr, min, max, nullptr);
+  }
+
+  template <class C>
+  constexpr Param<C> paramString(const char *key, String C::*member, const char *defaultValue, uint8_t flags = 0, const char *formName = nullptr, ParamValidator validator = nullptr)
+  {
+    return Param<C>(key, formName, PARAM_STRING, member, flags, 0, defaultValue, 1, 0, validator);
+  }
+
+  /** Generic load, store and form binding of the parameters described by a table of Param<C>.
+   * Replaces the hand written _initParams(), _fromJson(), fillJson() and form parser of a module:
+   *
+   *     const Param<Mail> Mail::PARAM_LIST[] = {
+   *         paramString<Mail>("smtp", &Mail::_mailServer, "", PARAM_FORM_NON_EMPTY),
+   *         paramUInt16<Mail>("port", &Mail::_mailPort, 587, 1, UINT16_MAX)};
+   *     const ParamTable<Mail> Mail::PARAMS(Mail::PARAM_LIST);
+   *
+   * Each operation is one walk over the table. The table is constant data: on ESP32 it is placed in flash,
+   * on ESP8266 the table and its key strings are in RAM (about 40 bytes per parameter plus the keys). **/
+  template <class C>
+  class ParamTable
+  {
+  public:
+    template <size_t N>
+    constexpr ParamTable(const Param<C> (&params)[N]) : _params(params), _count(N) {}
+
+    size_t count() const { return _count; }
+    const Param<C> &at(size_t index) const { return _params[index]; }
+
+    /** Sets all parameter to their defaults. **/
+    void init(C &obj) const
+    {
+      for (size_t i = 0; i < _count; i++)
+      {
+        const Param<C> &p = _params[i];
+        switch (p.type)
+        {
+        case PARAM_BOOL:
+          obj.*(p.member.b) = p.defaultNumber != 0;
+          break;
+        case PARAM_INT:
+          obj.*(p.member.i) = p.defaultNumber;
+          break;
+        case PARAM_UINT16:
+          obj.*(p.member.u16) = p.defaultNumber;
+          break;
+        case PARAM_STRING:
+          obj.*(p.member.s) = p.defaultString != nullptr ? p.defaultString : "";
+          break;
+        }
+      }
+    }
+
+    /** Reads the parameter from the JSON object of the module. Missing or invalid values keep the current value. **/
+    void fromJson(C &obj, JsonVariantConst json) const
+    {
+      for (size_t i = 0; i < _count; i++)
+      {
+        const Param<C> &p = _params[i];
+        JsonVariantConst jv = json[p.key];
+        if (jv.isNull())
+        {
+          continue;
+        }
+        switch (p.type)
+        {
+        case PARAM_BOOL:
+          obj.*(p.member.b) = jv.as<bool>();
+          break;
+        case PARAM_INT:
+          if (p.valid(jv.as<long>()))
+          {
+            obj.*(p.member.i) = jv.as<int>();
+          }
+          break;
+        case PARAM_UINT16:
+          if (p.valid(jv.as<long>()))
+          {
+            obj.*(p.member.u16) = jv.as<uint16_t>();
+          }
+          break;
+        case PARAM_STRING:
+          if (p.valid(jv.as<const char *>()))
+          {
+            obj.*(p.member.s) = jv.as<const char *>();
+          }
+          break;
+        }
+      }
+    }
+
+    /** Writes the parameter into the JSON object of the module. Set secrets to false for responses to the browser. **/
+    void toJson(const C &obj, JsonObject json, bool secrets = true) const
+    {
+      for (size_t i = 0; i < _count; i++)
+      {
+        const Param<C> &p = _params[i];
+        if (!secrets && (p.flags & PARAM_SECRET))
+        {
+          continue;
+        }
+        switch (p.type)
+        {
+        case PARAM_BOOL:
+          json[p.key] = obj.*(p.member.b);
+          break;
+        case PARAM_INT:
+          json[p.key] = obj.*(p.member.i);
+          break;
+        case PARAM_UINT16:
+          json[p.key] = obj.*(p.member.u16);
+          break;
+        case PARAM_STRING:
+          json[p.key] = obj.*(p.member.s);
+          break;
+        }
+      }
+    }
+
+    /** Removes the secret parameter from a JSON object written by toJson(), e.g. before it is sent to the browser. **/
+    void removeSecrets(JsonObject json) const
+    {
+      for (size_t i = 0; i < _count; i++)
+      {
+        if (_params[i].flags & PARAM_SECRET)
+        {
+          json.remove(_params[i].key);
+        }
+      }
+    }
+
+    /** Copies the form arguments of the request into the JSON object, to be applied by fromJson(). **/
+    void fromForm(WebServer *request, JsonObject json) const
+    {
+      for (size_t i = 0; i < _count; i++)
+      {
+        const Param<C> &p = _params[i];
+        const char *name = p.form();
+        if ((p.flags & PARAM_SECRET) && request->arg(String(name) + F("_clear")).equals("true"))
+        {
+          json[p.key] = "";
+          continue;
+        }
+        if (!request->hasArg(name))
+        {
+          if (p.flags & PARAM_FORM_CHECKBOX)
+          {
+            json[p.key] = false;
+          }
+          continue;
+        }
+        String value = request->arg(name);
+        if (value.isEmpty() && (p.flags & (PARAM_FORM_NON_EMPTY | PARAM_SECRET)))
+        {
+          continue;
+        }
+        switch (p.type)
+        {
+        case PARAM_BOOL:
+          json[p.key] = value.equals("true") || value.equals("on");
+          break;
+        case PARAM_INT:
+        case PARAM_UINT16:
+          json[p.key] = value.toInt();
+          break;
+        case PARAM_STRING:
+          json[p.key] = value;
+          break;
+        }
+      }
+    }
+
+  protected:
+    const Param<C> *_params;
+    size_t _count;
+  };
+};
+#endif
@@ -0,0 +1,81 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+#include "ewcProfiler.h"
+
+#ifdef EWC_PROFILE
+#include <string.h>
+
+using namespace EWC;
+
+Profiler::Scope Profiler::_scopes[EWC_PROFILE_SCOPES];
+uint8_t Profiler::_count = 0;
+
+int8_t Profiler::registerScope(const char *name)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (strcmp(_scopes[i].name, name) == 0)
+    {
+      return i;
+    }
+  }
+  if (_count >= EWC_PROFILE_SCOPES)
+  {
+    return -1;
+  }
+  _scopes[_count].name = name;
+  _scopes[_count].ticks = ScopeHistogram(4);
+  return _count++;
+}
+
+void Profiler::reset()
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    _scopes[i].ticks.reset();
+  }
+}
+
+#ifdef ARDUINO
+void Profiler::print(Print &out)
+{
+  uint32_t tpu = ticksPerUs();
+  out.println(F("[EWC Profile] scope: count, min/avg/max/p99 us"));
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const ScopeHistogram &t = _scopes[i].ticks;
+    out.print(F("[EWC Profile] "));
+    out.print(_scopes[i].name);
+    out.print(F(": "));
+    out.print(t.count());
+    out.print(F(", "));
+    out.print(t.min() / tpu);
+    out.print('/');
+    out.print(t.avg() / tpu);
+    out.print('/');
+    out.print(t.max() / tpu);
+    out.print('/');
+    out.println(t.percentile(99) / tpu);
+  }
+}
+#endif
+#endif
@@ -0,0 +1,143 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_PROFILER_H
+#define EWC_PROFILER_H
+
+/**
+ * Scoped timers for the loops and handlers, enabled by build flag -D EWC_PROFILE.
+ * Without the flag EWC_PROFILE_SCOPE() expands to nothing.
+ *
+ *   void Mqtt::loop()
+ *   {
+ *     EWC_PROFILE_SCOPE("mqtt.loop");
+ *     ...
+ *   }
+ *
+ * On the board the time is measured by the CPU cycle counter, on host (without ARDUINO) by std::chrono
+ * in nanoseconds, so benchmarks can use the same scopes.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ewcHistogram.h"
+
+/** Maximal count of scopes, further scopes are not recorded. **/
+#ifndef EWC_PROFILE_SCOPES
+#define EWC_PROFILE_SCOPES 16
+#endif
+/** Interval to print the profile to the logger, 0 disables the report. **/
+#ifndef EWC_PROFILE_REPORT_MS
+#define EWC_PROFILE_REPORT_MS 60000
+#endif
+
+#ifdef EWC_PROFILE
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+namespace EWC
+{
+  /** Static table with the statistics of all scopes. The values are recorded in ticks:
+   * CPU cycles on the board and nanoseconds on host. **/
+  class Profiler
+  {
+  public:
+    /** 24 buckets starting at 16 ticks, the last one ends at 2^27 ticks: 0.84 s at 160 MHz, longer scopes are counted in the overflow bucket. **/
+    typedef BasicHistogram<24> ScopeHistogram;
+    struct Scope
+    {
+      const char *name;
+      ScopeHistogram ticks;
+    };
+
+    static inline uint32_t now()
+    {
+#ifdef ARDUINO
+      return ESP.getCycleCount();
+#else
+      return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+    static inline uint32_t ticksPerUs()
+    {
+#ifdef ARDUINO
+      return ESP.getCpuFreqMHz();
+#else
+      return 1000;
+#endif
+    }
+    /** Returns the index of the scope with given name, a new scope is added. Returns -1 if the table is full. **/
+    static int8_t registerScope(const char *name);
+    static void record(int8_t id, uint32_t ticks)
+    {
+      if (id >= 0)
+      {
+        _scopes[id].ticks.record(ticks);
+      }
+    }
+    static uint8_t count() { return _count; }
+    static const Scope &scope(uint8_t id) { return _scopes[id]; }
+    static void reset();
+#ifdef ARDUINO
+    /** Prints a table with count and min/avg/max/p99 in microseconds of each scope. **/
+    static void print(Print &out);
+#endif
+
+  protected:
+    static Scope _scopes[EWC_PROFILE_SCOPES];
+    static uint8_t _count;
+  };
+
+  /** Records the time from construction to destruction into the scope. **/
+  class ProfileScope
+  {
+  public:
+    ProfileScope(const char *name, int8_t &id)
+    {
+      if (id < 0)
+      {
+        id = Profiler::registerScope(name);
+      }
+      _id = id;
+      _start = Profiler::now();
+    }
+    ~ProfileScope() { Profiler::record(_id, Profiler::now() - _start); }
+
+  protected:
+    int8_t _id;
+    uint32_t _start;
+  };
+};
+
+#define EWC_PROFILE_CONCAT_(a, b) a##b
+#define EWC_PROFILE_CONCAT(a, b) EWC_PROFILE_CONCAT_(a, b)
+/** The scope is resolved by name only once, the index is kept in a static variable. **/
+#define EWC_PROFILE_SCOPE(name)                                         \
+  static int8_t EWC_PROFILE_CONCAT(_ewcProfileId, __LINE__) = -1;       \
+  EWC::ProfileScope EWC_PROFILE_CONCAT(_ewcProfileScope, __LINE__)(name, \
+                                                                   EWC_PROFILE_CONCAT(_ewcProfileId, __LINE__))
+#else
+#define EWC_PROFILE_SCOPE(name)
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+#include "ewcRequestHandler.h"
+#include "ewcConfigServer.h"
+#include "ewcMetrics.h"
+
+using namespace EWC;
+
+struct Probe
+{
+  PGM_P match;
+  Metrics::ProbeOS os;
+};
+
+static const char PROBE_GENERATE_204[] PROGMEM = "/generate_204";
+static const char PROBE_GEN_204[] PROGMEM = "/gen_204";
+static const char PROBE_HOTSPOT_DETECT[] PROGMEM = "/hotspot-detect.html";
+static const char PROBE_APPLE_SUCCESS[] PROGMEM = "/library/test/success.html";
+static const char PROBE_CONNECTTEST[] PROGMEM = "/connecttest.txt";
+static const char PROBE_NCSI[] PROGMEM = "/ncsi.txt";
+static const char PROBE_REDIRECT[] PROGMEM = "/redirect";
+static const char PROBE_FWLINK[] PROGMEM = "/fwlink";
+static const char PROBE_FIREFOX_SUCCESS[] PROGMEM = "/success.txt";
+static const char PROBE_CANONICAL[] PROGMEM = "/canonical.html";
+
+/** Probe paths, compared case sensitive. **/
+static const Probe PROBE_PATHS[] = {
+    {PROBE_GENERATE_204, Metrics::PROBE_ANDROID},
+    {PROBE_GEN_204, Metrics::PROBE_ANDROID},
+    {PROBE_HOTSPOT_DETECT, Metrics::PROBE_APPLE},
+    {PROBE_APPLE_SUCCESS, Metrics::PROBE_APPLE},
+    {PROBE_CONNECTTEST, Metrics::PROBE_WINDOWS},
+    {PROBE_NCSI, Metrics::PROBE_WINDOWS},
+    {PROBE_REDIRECT, Metrics::PROBE_WINDOWS},
+    {PROBE_FWLINK, Metrics::PROBE_WINDOWS},
+    {PROBE_FIREFOX_SUCCESS, Metrics::PROBE_FIREFOX},
+    {PROBE_CANONICAL, Metrics::PROBE_FIREFOX},
+};
+
+static const char PROBE_HOST_GSTATIC[] PROGMEM = "connectivitycheck.gstatic.com";
+static const char PROBE_HOST_ANDROID[] PROGMEM = "connectivitycheck.android.com";
+static const char PROBE_HOST_GOOGLE[] PROGMEM = "clients3.google.com";
+static const char PROBE_HOST_APPLE[] PROGMEM = "captive.apple.com";
+static const char PROBE_HOST_MSFTCONNECT[] PROGMEM = "www.msftconnecttest.com";
+static const char PROBE_HOST_MSFTNCSI[] PROGMEM = "www.msftncsi.com";
+static const char PROBE_HOST_FIREFOX[] PROGMEM = "detectportal.firefox.com";
+
+/** Probe hosts, any path on these hosts is a probe. Compared case insensitive. **/
+static const Probe PROBE_HOSTS[] = {
+    {PROBE_HOST_GSTATIC, Metrics::PROBE_ANDROID},
+    {PROBE_HOST_ANDROID, Metrics::PROBE_ANDROID},
+    {PROBE_HOST_GOOGLE, Metrics::PROBE_ANDROID},
+    {PROBE_HOST_APPLE, Metrics::PROBE_APPLE},
+    {PROBE_HOST_MSFTCONNECT, Metrics::PROBE_WINDOWS},
+    {PROBE_HOST_MSFTNCSI, Metrics::PROBE_WINDOWS},
+    {PROBE_HOST_FIREFOX, Metrics::PROBE_FIREFOX},
+};
+
+bool MetricsHandler::canHandle(HTTPMethod method, EWC_REQUEST_URI uri)
+{
+  I::get().metrics().requestStarted();
+  return false;
+}
+
+bool ProbeHandler::canHandle(HTTPMethod method, EWC_REQUEST_URI uri)
+{
+  if (!_configServer.isAP())
+  {
+    return false;
+  }
+  // the headers of the request are not parsed yet, so only the path is matched here
+  for (const Probe &probe : PROBE_PATHS)
+  {
+    if (strcmp_P(uri.c_str(), probe.match) == 0)
+    {
+      _os = probe.os;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ProbeHandler::handleHost(WebServer &server)
+{
+  const String &host = server.hostHeader();
+  for (const Probe &probe : PROBE_HOSTS)
+  {
+    if (strcasecmp_P(host.c_str(), probe.match) == 0)
+    {
+      _os = probe.os;
+      _redirect(server);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ProbeHandler::handle(WebServer &server, HTTPMethod requestMethod, EWC_REQUEST_URI requestUri)
+{
+  if (!canHandle(requestMethod, requestUri))
+  {
+    return false;
+  }
+  _redirect(server);
+  return true;
+}
+
+void ProbeHandler::_redirect(WebServer &server)
+{
+  I::get().metrics().captiveProbe((Metrics::ProbeOS)_os);
+  I::get().metrics().requestUnrouted();
+  IPAddress ip = server.client().localIP();
+  if ((uint32_t)ip != _locationIP)
+  {
+    _locationIP = (uint32_t)ip;
+    snprintf_P(_location, sizeof(_location), PSTR("http://%u.%u.%u.%u/wifi/setup"), ip[0], ip[1], ip[2], ip[3]);
+  }
+  server.sendHeader("Location", _location);
+  server.sendHeader("Cache-Control", "no-cache, no-store");
+  server.setContentLength(0);
+  server.send(302, "text/plain", "");
+}
+
+bool AssetHandler::canHandle(HTTPMethod method, EWC_REQUEST_URI uri)
+{
+  if (method != HTTP_GET)
+  {
+    return false;
+  }
+  if (!_configServer._findAsset(uri.c_str(), _table, _index))
+  {
+    return false;
+  }
+  return (_table->flags[_index] & ASSET_ENABLED) != 0;
+}
+
+bool AssetHandler::handle(WebServer &server, HTTPMethod requestMethod, EWC_REQUEST_URI requestUri)
+{
+  if (!canHandle(requestMethod, requestUri))
+  {
+    return false;
+  }
+  if (!(_table->flags[_index] & ASSET_NO_AUTH) && !_configServer.isAuthenticated(&server))
+  {
+    server.requestAuthentication();
+    return true;
+  }
+  _configServer._sendAsset(&server, *_table, _index);
+  return true;
+}
@@ -0,0 +1,89 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_REQUEST_HANDLER_H
+#define EWC_REQUEST_HANDLER_H
+
+#ifdef ESP8266
+#include <ESP8266WebServer.h>
+#define WebServer ESP8266WebServer
+#elif defined(ESP32)
+#include <WebServer.h>
+#endif
+#include "ewcAssetManifest.h"
+
+/** The ESP32 core before 3.0 passes the URI to the RequestHandler by value. **/
+#if defined(ESP32) && (!defined(ESP_ARDUINO_VERSION_MAJOR) || ESP_ARDUINO_VERSION_MAJOR < 3)
+#define EWC_REQUEST_URI String
+#else
+#define EWC_REQUEST_URI const String &
+#endif
+
+namespace EWC
+{
+  class ConfigServer;
+
+  /** Added as first handler, so it is asked first on each request: marks the start of the request for the metrics.
+   * It never handles a request. **/
+  class MetricsHandler : public RequestHandler
+  {
+  public:
+    bool canHandle(HTTPMethod method, EWC_REQUEST_URI uri) override;
+  };
+
+  /** Answers the connectivity probes of the operating systems while the configuration portal is active.
+   * Known probe paths and hosts are looked up in a table in flash and redirected to the WiFi setup page
+   * without logging or building messages. Added directly after the MetricsHandler, so a burst of probes
+   * does not pass the routes and the not found handler. The Host header is not parsed when canHandle()
+   * is called, requests to the probe hosts are matched by handleHost() from the not found handler. **/
+  class ProbeHandler : public RequestHandler
+  {
+  public:
+    explicit ProbeHandler(ConfigServer &configServer) : _configServer(configServer) {}
+    bool canHandle(HTTPMethod method, EWC_REQUEST_URI uri) override;
+    bool handle(WebServer &server, HTTPMethod requestMethod, EWC_REQUEST_URI requestUri) override;
+    /** Redirects the current request if its Host header is a known probe host, returns true in that case. **/
+    bool handleHost(WebServer &server);
+
+  protected:
+    ConfigServer &_configServer;
+    uint8_t _os = 0;            //< operating system of the last match in canHandle()
+    uint32_t _locationIP = 0;   //< local IP used in _location
+    char _location[40] = {0};   //< redirect target, built once per local IP
+
+    void _redirect(WebServer &server);
+  };
+
+  /** Serves all enabled entries of the asset manifests registered in ConfigServer.
+   * One handler replaces a route for each file, the path is resolved by binary search in the sorted manifests. **/
+  class AssetHandler : public RequestHandler
+  {
+  public:
+    explicit AssetHandler(ConfigServer &configServer) : _configServer(configServer) {}
+    bool canHandle(HTTPMethod method, EWC_REQUEST_URI uri) override;
+    bool handle(WebServer &server, HTTPMethod requestMethod, EWC_REQUEST_URI requestUri) override;
+
+  protected:
+    ConfigServer &_configServer;
+    AssetTable *_table = nullptr; //< table of the last match in canHandle()
+    size_t _index = 0;            //< index of the last match in canHandle()
+  };
+};
+#endif
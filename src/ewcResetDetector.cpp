@@ -0,0 +1,157 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#include <LittleFS.h>
+#if defined(ESP8266)
+extern "C"
+{
+#include <user_interface.h>
+}
+#else
+#include <esp_system.h>
+#endif
+#include "ewcResetDetector.h"
+#include "ewcInterface.h"
+
+using namespace EWC;
+
+#ifdef EWC_RESET_DETECTOR_USE_RTC
+/** Marks valid content, RTC memory is random after power on. **/
+static const uint32_t RESET_MAGIC = 0x45574352UL;
+
+struct ResetRtcData
+{
+  uint32_t magic;
+  uint32_t count;
+};
+
+#if defined(ESP32)
+RTC_NOINIT_ATTR static ResetRtcData rtcResetData;
+#endif
+#endif
+
+ResetDetector::ResetDetector()
+{
+  _waiting = false;
+  _startTs = 0;
+}
+
+/** True for power on and reset button, a deep sleep wake up or a restart by the firmware is no reset by the user. **/
+bool ResetDetector::_countedReason()
+{
+#if defined(ESP8266)
+  uint32_t reason = ESP.getResetInfoPtr()->reason;
+  return reason == REASON_DEFAULT_RST || reason == REASON_EXT_SYS_RST;
+#else
+  esp_reset_reason_t reason = esp_reset_reason();
+  return reason == ESP_RST_POWERON || reason == ESP_RST_EXT;
+#endif
+}
+
+uint8_t ResetDetector::begin()
+{
+  if (!_countedReason())
+  {
+    I::get().logger() << F("[EWC ResetDetector]: no reset by user, clear reset count") << endl;
+    _clear();
+    return 0;
+  }
+  uint8_t count = _read();
+  I::get().logger() << F("[EWC ResetDetector]: reset count: ") << (uint32_t)count << endl;
+  // saturate to avoid restarting the sequence by overflow
+  _write(count < 255 ? count + 1 : count);
+  _startTs = millis();
+  _waiting = true;
+  return count;
+}
+
+void ResetDetector::loop()
+{
+  if (_waiting && millis() - _startTs > EWC_RESET_WINDOW_MS)
+  {
+    I::get().logger() << F("[EWC ResetDetector]: window expired, clear reset count") << endl;
+    _waiting = false;
+    _clear();
+  }
+}
+
+#ifdef EWC_RESET_DETECTOR_USE_RTC
+uint8_t ResetDetector::_read()
+{
+  ResetRtcData data;
+#if defined(ESP8266)
+  if (!ESP.rtcUserMemoryRead(EWC_RESET_RTC_OFFSET, reinterpret_cast<uint32_t *>(&data), sizeof(data)))
+  {
+    return 0;
+  }
+#else
+  data = rtcResetData;
+#endif
+  if (data.magic != (RESET_MAGIC ^ data.count) || data.count > 255)
+  {
+    return 0;
+  }
+  return data.count;
+}
+
+void ResetDetector::_write(uint8_t count)
+{
+  ResetRtcData data;
+  data.count = count;
+  data.magic = RESET_MAGIC ^ data.count;
+#if defined(ESP8266)
+  ESP.rtcUserMemoryWrite(EWC_RESET_RTC_OFFSET, reinterpret_cast<uint32_t *>(&data), sizeof(data));
+#else
+  rtcResetData = data;
+#endif
+}
+
+void ResetDetector::_clear()
+{
+  _write(0);
+}
+#else
+uint8_t ResetDetector::_read()
+{
+  uint8_t count = 0;
+  File resetFile = LittleFS.open(FPSTR(RESET_FILENAME), "r");
+  if (resetFile && !resetFile.isDirectory())
+  {
+    count = resetFile.readString().toInt();
+    resetFile.close();
+  }
+  return count;
+}
+
+void ResetDetector::_write(uint8_t count)
+{
+  File resetFile = LittleFS.open(FPSTR(RESET_FILENAME), "w");
+  if (resetFile)
+  {
+    resetFile.print(count);
+    resetFile.close();
+  }
+}
+
+void ResetDetector::_clear()
+{
+  LittleFS.remove(FPSTR(RESET_FILENAME));
+}
+#endif
@@ -0,0 +1,77 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_RESET_DETECTOR_H
+#define EWC_RESET_DETECTOR_H
+
+/**
+ * Counts resets which occur shortly after boot without delaying the boot.
+ * The counter is incremented in begin() and cleared by loop() when the device
+ * survived EWC_RESET_WINDOW_MS. Only power on and external (reset button) resets
+ * are counted, any other reset reason (e.g. wake from deep sleep, watchdog,
+ * software restart) clears the counter. On ESP8266 the counter is kept in RTC user
+ * memory, on ESP32 in RTC no-init RAM. With -D EWC_RESET_DETECTOR_FILE it is kept
+ * in a file in LittleFS instead.
+ */
+
+#include <Arduino.h>
+
+/** Time after boot in which a reset is counted. **/
+#ifndef EWC_RESET_WINDOW_MS
+#define EWC_RESET_WINDOW_MS 2000
+#endif
+/** Offset in 4 byte blocks in the RTC user memory of ESP8266. The first 128 bytes are used by OTA. **/
+#ifndef EWC_RESET_RTC_OFFSET
+#define EWC_RESET_RTC_OFFSET 32
+#endif
+
+#if !defined(EWC_RESET_DETECTOR_FILE) && (defined(ESP8266) || defined(ESP32))
+#define EWC_RESET_DETECTOR_USE_RTC
+#endif
+
+namespace EWC
+{
+  const char RESET_FILENAME[] PROGMEM = "/reset.lock";
+
+  class ResetDetector
+  {
+  public:
+    ResetDetector();
+
+    /** Reads the count of previous resets inside the window and stores the incremented value.
+     * LittleFS must be mounted if the file fallback is used.
+     * Returns the count read, 0 on normal boot or if the reset was not caused by power on or the reset button. **/
+    uint8_t begin();
+    /** Clears the counter after the window expired. **/
+    void loop();
+    /** True while the window is open. **/
+    bool waiting() const { return _waiting; }
+
+  protected:
+    bool _waiting;
+    unsigned long _startTs;
+
+    static bool _countedReason();
+    uint8_t _read();
+    void _write(uint8_t count);
+    void _clear();
+  };
+};
+#endif
@@ -0,0 +1,128 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+#include "ewcResponseCache.h"
+
+using namespace EWC;
+
+ResponseCache::ResponseCache(size_t budget)
+    : _budget(budget), _used(0), _tick(0), _hits(0), _misses(0), _evictions(0)
+{
+}
+
+ResponseCache::~ResponseCache()
+{
+  clear();
+}
+
+const ResponseCache::Entry *ResponseCache::get(size_t key, uint32_t generation)
+{
+  for (size_t i = 0; i < _entries.size(); i++)
+  {
+    if (_entries[i].key == key)
+    {
+      if (_entries[i].generation == generation)
+      {
+        _hits++;
+        _entries[i].lastUsed = ++_tick;
+        return &_entries[i];
+      }
+      // outdated, the configuration was changed since
+      _remove(i);
+      break;
+    }
+  }
+  _misses++;
+  return nullptr;
+}
+
+const ResponseCache::Entry *ResponseCache::put(size_t key, uint32_t generation, JsonVariantConst json)
+{
+  size_t len = measureJson(json);
+  if (len > _budget)
+  {
+    return nullptr;
+  }
+  for (size_t i = 0; i < _entries.size(); i++)
+  {
+    if (_entries[i].key == key)
+    {
+      _remove(i);
+      break;
+    }
+  }
+  while (_used + len > _budget && _evictLRU())
+  {
+  }
+  char *data = static_cast<char *>(malloc(len + 1));
+  if (data == nullptr)
+  {
+    return nullptr;
+  }
+  serializeJson(json, data, len + 1);
+  _entries.push_back({key, generation, ++_tick, data, len});
+  _used += len;
+  return &_entries.back();
+}
+
+void ResponseCache::clear()
+{
+  for (auto &entry : _entries)
+  {
+    free(entry.data);
+  }
+  _entries.clear();
+  _used = 0;
+}
+
+void ResponseCache::setBudget(size_t budget)
+{
+  _budget = budget;
+  while (_used > _budget && _evictLRU())
+  {
+  }
+}
+
+void ResponseCache::_remove(size_t index)
+{
+  free(_entries[index].data);
+  _used -= _entries[index].len;
+  _entries.erase(_entries.begin() + index);
+}
+
+bool ResponseCache::_evictLRU()
+{
+  if (_entries.empty())
+  {
+    return false;
+  }
+  size_t lru = 0;
+  for (size_t i = 1; i < _entries.size(); i++)
+  {
+    if (_entries[i].lastUsed < _entries[lru].lastUsed)
+    {
+      lru = i;
+    }
+  }
+  _remove(lru);
+  _evictions++;
+  return true;
+}
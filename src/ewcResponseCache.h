@@ -0,0 +1,78 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_RESPONSE_CACHE_H
+#define EWC_RESPONSE_CACHE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+
+/** RAM budget in bytes for the serialized JSON responses. **/
+#ifndef EWC_RESPONSE_CACHE_SIZE
+#define EWC_RESPONSE_CACHE_SIZE 2048
+#endif
+
+namespace EWC
+{
+  /** Keeps serialized JSON responses of idempotent endpoints.
+   * An entry is valid as long as the generation it was stored with is current, e.g. until the configuration
+   * was saved again. If the budget is exceeded the least recently used entries are removed. **/
+  class ResponseCache
+  {
+  public:
+    struct Entry
+    {
+      size_t key;
+      uint32_t generation;
+      uint32_t lastUsed;
+      char *data;
+      size_t len;
+    };
+
+    explicit ResponseCache(size_t budget = EWC_RESPONSE_CACHE_SIZE);
+    ~ResponseCache();
+    /** Returns the entry for key, if it was stored with given generation. Otherwise nullptr. **/
+    const Entry *get(size_t key, uint32_t generation);
+    /** Serializes the document and stores it for key. Returns nullptr if the document does not fit into the budget.
+     * The returned entry is valid until the next call of put(). **/
+    const Entry *put(size_t key, uint32_t generation, JsonVariantConst json);
+    void clear();
+    void setBudget(size_t budget);
+    size_t budget() const { return _budget; }
+    size_t used() const { return _used; }
+    uint32_t hits() const { return _hits; }
+    uint32_t misses() const { return _misses; }
+    uint32_t evictions() const { return _evictions; }
+
+  protected:
+    size_t _budget;
+    size_t _used;
+    uint32_t _tick;
+    uint32_t _hits;
+    uint32_t _misses;
+    uint32_t _evictions;
+    std::vector<Entry> _entries;
+
+    void _remove(size_t index);
+    bool _evictLRU();
+  };
+};
+#endif
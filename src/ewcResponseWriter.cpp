@@ -0,0 +1,135 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+#include "ewcResponseWriter.h"
+
+using namespace EWC;
+
+ResponseWriter::ResponseWriter(WebServer *webServer)
+    : _webServer(webServer), _len(0), _written(0), _chunked(false), _ended(false)
+{
+}
+
+ResponseWriter::~ResponseWriter()
+{
+  end();
+}
+
+void ResponseWriter::begin(int code, const String &contentType, size_t contentLength)
+{
+  _chunked = contentLength == CONTENT_LENGTH_UNKNOWN;
+  _webServer->setContentLength(contentLength);
+  _webServer->send(code, contentType.c_str(), "");
+}
+
+void ResponseWriter::end()
+{
+  if (_ended)
+  {
+    return;
+  }
+  flush();
+  if (_chunked)
+  {
+    // empty chunk terminates the chunked response
+    _webServer->sendContent("");
+  }
+  _ended = true;
+}
+
+size_t ResponseWriter::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t ResponseWriter::write(const uint8_t *buffer, size_t size)
+{
+  size_t remaining = size;
+  while (remaining > 0)
+  {
+    if (_len == EWC_RESPONSE_BUFFER_SIZE)
+    {
+      flush();
+    }
+    size_t n = EWC_RESPONSE_BUFFER_SIZE - _len;
+    if (n > remaining)
+    {
+      n = remaining;
+    }
+    memcpy(_buffer + _len, buffer, n);
+    _len += n;
+    buffer += n;
+    remaining -= n;
+  }
+  _written += size;
+  return size;
+}
+
+size_t ResponseWriter::writeP(PGM_P buffer, size_t size)
+{
+  size_t remaining = size;
+  while (remaining > 0)
+  {
+    if (_len == EWC_RESPONSE_BUFFER_SIZE)
+    {
+      flush();
+    }
+    size_t n = EWC_RESPONSE_BUFFER_SIZE - _len;
+    if (n > remaining)
+    {
+      n = remaining;
+    }
+    memcpy_P(_buffer + _len, buffer, n);
+    _len += n;
+    buffer += n;
+    remaining -= n;
+  }
+  _written += size;
+  return size;
+}
+
+size_t ResponseWriter::sendP(int code, const String &contentType, PGM_P content, size_t size)
+{
+  begin(code, contentType, size);
+  size_t sent = 0;
+  while (sent < size && _webServer->client().connected())
+  {
+    size_t chunk = size - sent;
+    if (chunk > EWC_STREAM_CHUNK_SIZE)
+    {
+      chunk = EWC_STREAM_CHUNK_SIZE;
+    }
+    _webServer->sendContent_P(content + sent, chunk);
+    sent += chunk;
+    yield();
+  }
+  _written += sent;
+  return sent;
+}
+
+void ResponseWriter::flush()
+{
+  if (_len > 0 && _webServer->client().connected())
+  {
+    _webServer->sendContent(_buffer, _len);
+  }
+  _len = 0;
+}
@@ -0,0 +1,80 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_RESPONSE_WRITER_H
+#define EWC_RESPONSE_WRITER_H
+
+#include <Arduino.h>
+#ifdef ESP8266
+#include <ESP8266WebServer.h>
+#define WebServer ESP8266WebServer
+#elif defined(ESP32)
+#include <WebServer.h>
+#endif
+
+/** Size of the buffer used to collect small writes before they are sent to the client. **/
+#ifndef EWC_RESPONSE_BUFFER_SIZE
+#define EWC_RESPONSE_BUFFER_SIZE 512
+#endif
+/** Size of the chunks used to stream content from flash to the client. Defaults to the TCP MSS. **/
+#ifndef EWC_STREAM_CHUNK_SIZE
+#ifdef TCP_MSS
+#define EWC_STREAM_CHUNK_SIZE TCP_MSS
+#else
+#define EWC_STREAM_CHUNK_SIZE 536
+#endif
+#endif
+
+namespace EWC
+{
+  /** Writes the response body directly to the client of the web server.
+   * Used as Print target, e.g. for serializeJson(), so the response is never built as String in the heap.
+   * Small writes are collected in a buffer on the stack and sent with sendContent().
+   * If begin() is called without content length, the response is sent with chunked transfer encoding. **/
+  class ResponseWriter : public Print
+  {
+  public:
+    explicit ResponseWriter(WebServer *webServer);
+    ~ResponseWriter();
+    /** Sends the header. Use CONTENT_LENGTH_UNKNOWN if the size is not known before. **/
+    void begin(int code, const String &contentType, size_t contentLength = CONTENT_LENGTH_UNKNOWN);
+    /** Sends the remaining content and terminates a chunked response. Called by destructor, if not called before. **/
+    void end();
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    void flush() override;
+    /** Writes content stored in flash. **/
+    size_t writeP(PGM_P buffer, size_t size);
+    /** Sends the header with content length and the content directly from flash in chunks of EWC_STREAM_CHUNK_SIZE bytes,
+     * bypassing the buffer. Returns the count of bytes sent, less than size if the client disconnected. **/
+    size_t sendP(int code, const String &contentType, PGM_P content, size_t size);
+    /** Count of body bytes written to this writer. **/
+    size_t written() const { return _written; }
+
+  protected:
+    WebServer *_webServer;
+    char _buffer[EWC_RESPONSE_BUFFER_SIZE];
+    size_t _len;
+    size_t _written;
+    bool _chunked;
+    bool _ended;
+  };
+};
+#endif
@@ -0,0 +1,109 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#include "ewcRoaming.h"
+
+using namespace EWC;
+
+static const char *const DECISION_NAMES[] = {"none", "scan", "roam", "stay"};
+
+Roaming::Roaming()
+    : _threshold(EWC_ROAMING_THRESHOLD),
+      _hysteresis(EWC_ROAMING_HYSTERESIS),
+      _scanInterval(EWC_ROAMING_SCAN_INTERVAL_MS)
+{
+  reset();
+}
+
+void Roaming::configure(int8_t threshold, uint8_t hysteresis, uint32_t scanIntervalMs)
+{
+  _threshold = threshold;
+  _hysteresis = hysteresis;
+  _scanInterval = scanIntervalMs;
+}
+
+void Roaming::reset()
+{
+  _average = 0;
+  _samples = 0;
+  _scanning = false;
+  _scanned = false;
+  _scanTs = 0;
+}
+
+Roaming::Decision Roaming::sample(int8_t rssi, uint32_t now)
+{
+  if (rssi >= 0)
+  {
+    // the WiFi libraries report 0 or 31 if not connected
+    return NONE;
+  }
+  const int32_t scaled = (int32_t)rssi * (1 << EWC_ROAMING_EMA_SHIFT);
+  if (_samples == 0)
+  {
+    _average = scaled;
+  }
+  else
+  {
+    _average += (scaled - _average) / (1 << EWC_ROAMING_EMA_SHIFT);
+  }
+  if (_samples < (1 << EWC_ROAMING_EMA_SHIFT))
+  {
+    _samples++;
+    return NONE;
+  }
+  if (_scanning)
+  {
+    if (now - _scanTs < EWC_ROAMING_SCAN_TIMEOUT_MS)
+    {
+      return NONE;
+    }
+    // no result, e.g. the scan was aborted
+    _scanning = false;
+  }
+  if (average() >= _threshold || (_scanned && now - _scanTs < _scanInterval))
+  {
+    return NONE;
+  }
+  _scanning = true;
+  _scanned = true;
+  _scanTs = now;
+  return SCAN;
+}
+
+Roaming::Decision Roaming::evaluate(bool found, bool sameBssid, int8_t rssi)
+{
+  _scanning = false;
+  if (found && !sameBssid && (int16_t)rssi >= (int16_t)average() + _hysteresis)
+  {
+    return ROAM;
+  }
+  return STAY;
+}
+
+int8_t Roaming::average() const
+{
+  return _average / (1 << EWC_ROAMING_EMA_SHIFT);
+}
+
+const char *Roaming::decisionName(Decision decision)
+{
+  return decision <= STAY ? DECISION_NAMES[decision] : "unknown";
+}
@@ -0,0 +1,99 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_ROAMING_H
+#define EWC_ROAMING_H
+
+/**
+ * Decision logic of the background roaming: the RSSI of the current connection is smoothed by an
+ * exponential moving average. If the average falls below the threshold a scan is requested, at most
+ * once per scan interval. The scan result of the current SSID is evaluated: the device roams only if
+ * the best access point is another BSSID and better than the average by the hysteresis margin.
+ * The module has no dependency to the WiFi library, the time is passed in, so recorded RSSI traces
+ * can be replayed on host.
+ */
+
+#include <stdint.h>
+
+/** Average RSSI in dBm below which a roaming scan is started. **/
+#ifndef EWC_ROAMING_THRESHOLD
+#define EWC_ROAMING_THRESHOLD -75
+#endif
+/** Required improvement in dB of another access point over the current average. **/
+#ifndef EWC_ROAMING_HYSTERESIS
+#define EWC_ROAMING_HYSTERESIS 8
+#endif
+/** Minimal time between two roaming scans. **/
+#ifndef EWC_ROAMING_SCAN_INTERVAL_MS
+#define EWC_ROAMING_SCAN_INTERVAL_MS 60000
+#endif
+/** A scan without result after this time is dropped. **/
+#ifndef EWC_ROAMING_SCAN_TIMEOUT_MS
+#define EWC_ROAMING_SCAN_TIMEOUT_MS 15000
+#endif
+/** Weight of a new sample is 1 / 2^shift, the first 2^shift samples only fill the average. **/
+#ifndef EWC_ROAMING_EMA_SHIFT
+#define EWC_ROAMING_EMA_SHIFT 3
+#endif
+/** Interval of the RSSI samples taken by ConfigServer. **/
+#ifndef EWC_ROAMING_SAMPLE_MS
+#define EWC_ROAMING_SAMPLE_MS 1000
+#endif
+
+namespace EWC
+{
+  class Roaming
+  {
+  public:
+    enum Decision : uint8_t
+    {
+      NONE, //< nothing to do
+      SCAN, //< start a scan and call evaluate() with the result
+      ROAM, //< reassociate to the found access point
+      STAY  //< keep the current access point
+    };
+
+    Roaming();
+    void configure(int8_t threshold, uint8_t hysteresis, uint32_t scanIntervalMs);
+    /** Clears the average and the scan state, called after each (re)association. **/
+    void reset();
+    /** Adds an RSSI sample of the current connection. Returns SCAN if a roaming scan should be started. **/
+    Decision sample(int8_t rssi, uint32_t now);
+    /** Evaluates the best access point of the current SSID found by the scan. Returns ROAM or STAY. **/
+    Decision evaluate(bool found, bool sameBssid, int8_t rssi);
+    /** Smoothed RSSI in dBm, 0 if no sample was added. **/
+    int8_t average() const;
+    bool scanning() const { return _scanning; }
+    int8_t threshold() const { return _threshold; }
+    uint8_t hysteresis() const { return _hysteresis; }
+    static const char *decisionName(Decision decision);
+
+  protected:
+    int8_t _threshold;
+    uint8_t _hysteresis;
+    uint32_t _scanInterval;
+    int32_t _average; //< RSSI * 2^EWC_ROAMING_EMA_SHIFT
+    uint16_t _samples;
+    bool _scanning;
+    bool _scanned;
+    uint32_t _scanTs;
+  };
+};
+#endif
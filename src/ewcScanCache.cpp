@@ -0,0 +1,175 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+#include <algorithm>
+#include "ewcScanCache.h"
+#include "ewcVersionTag.h"
+
+using namespace EWC;
+
+ScanCache::ScanCache() : _generation(0)
+{
+}
+
+uint32_t ScanCache::hash(const char *ssid)
+{
+  return VersionTag().add(ssid, strlen(ssid)).value();
+}
+
+bool ScanCache::update(uint8_t channel, bool complete)
+{
+  int n = WiFi.scanComplete();
+  if (n < 0)
+  {
+    if (channel == 0)
+    {
+      // running, failed or results already read
+      return false;
+    }
+    // a failed channel scan continues the sweep without networks on this channel
+    n = 0;
+  }
+  if (channel == 0)
+  {
+    _networks.clear();
+    _networks.reserve(n < EWC_SCAN_CACHE_SIZE ? n : EWC_SCAN_CACHE_SIZE);
+  }
+  else
+  {
+    // replace the networks seen on this channel by the last scan
+    _networks.erase(std::remove_if(_networks.begin(), _networks.end(), [channel](const Network &network)
+                                   { return network.channel == channel; }),
+                    _networks.end());
+  }
+  String ssid;
+  uint8_t encType;
+  int32_t rssi;
+  uint8_t *bssid;
+  int32_t netChannel;
+  bool isHidden;
+  for (int i = 0; i < n; i++)
+  {
+#ifdef ESP8266
+    bool result = WiFi.getNetworkInfo(i, ssid, encType, rssi, bssid, netChannel, isHidden);
+#else
+    bool result = WiFi.getNetworkInfo(i, ssid, encType, rssi, bssid, netChannel);
+#endif
+    if (!result || ssid.isEmpty())
+    {
+      continue;
+    }
+    uint32_t h = hash(ssid.c_str());
+    Network *found = nullptr;
+    for (Network &network : _networks)
+    {
+      if (network.hash == h && ssid.equals(network.ssid))
+      {
+        found = &network;
+        break;
+      }
+    }
+    if (found == nullptr)
+    {
+      if (_networks.size() >= EWC_SCAN_CACHE_SIZE)
+      {
+        // replace the weakest network
+        found = &*std::min_element(_networks.begin(), _networks.end(), [](const Network &a, const Network &b)
+                                   { return a.rssi < b.rssi; });
+        if (found->rssi >= rssi)
+        {
+          continue;
+        }
+      }
+      else
+      {
+        _networks.push_back(Network());
+        found = &_networks.back();
+      }
+      found->hash = h;
+      strncpy(found->ssid, ssid.c_str(), sizeof(found->ssid) - 1);
+      found->ssid[sizeof(found->ssid) - 1] = '\0';
+      found->rssi = INT8_MIN;
+    }
+    if (rssi > found->rssi)
+    {
+      // keep the access point with best signal
+      found->rssi = rssi;
+      found->channel = netChannel;
+      memcpy(found->bssid, bssid, sizeof(found->bssid));
+#ifdef ESP8266
+      found->encrypted = encType != ENC_TYPE_NONE;
+#else
+      found->encrypted = encType != wifi_auth_mode_t::WIFI_AUTH_OPEN;
+#endif
+    }
+  }
+  // the results are copied, free the memory of the WiFi library. scanComplete() returns now WIFI_SCAN_FAILED (-2)
+  WiFi.scanDelete();
+  std::sort(_networks.begin(), _networks.end(), [](const Network &a, const Network &b)
+            { return a.rssi > b.rssi; });
+  if (complete)
+  {
+    _generation++;
+  }
+  _serialize(complete);
+  return true;
+}
+
+int ScanCache::find(const String &ssid) const
+{
+  uint32_t h = hash(ssid.c_str());
+  for (size_t i = 0; i < _networks.size(); i++)
+  {
+    if (_networks[i].hash == h && ssid.equals(_networks[i].ssid))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void ScanCache::_serialize(bool complete)
+{
+  JsonDocument jsonDoc;
+  jsonDoc["finished"] = complete;
+  jsonDoc["failed"] = complete && _networks.empty();
+  jsonDoc["reason"] = complete && _networks.empty() ? "No networks found" : "";
+  JsonArray networks = jsonDoc["networks"].to<JsonArray>();
+  char mac[18];
+  for (const Network &network : _networks)
+  {
+    JsonObject jsonNetwork = networks.add<JsonObject>();
+    jsonNetwork["ssid"] = (const char *)network.ssid;
+    jsonNetwork["encrypted"] = network.encrypted;
+    jsonNetwork["rssi"] = network.rssi;
+    jsonNetwork["channel"] = network.channel;
+    sprintf(mac, "%02X:%02X:%02X:%02X:%02X:%02X", network.bssid[0], network.bssid[1], network.bssid[2], network.bssid[3], network.bssid[4], network.bssid[5]);
+    jsonNetwork["bssid"] = mac;
+    jsonNetwork["hidden"] = false;
+  }
+  _json = "";
+  _json.reserve(measureJson(jsonDoc));
+  serializeJson(jsonDoc, _json);
+}
@@ -0,0 +1,78 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_SCAN_CACHE_H
+#define EWC_SCAN_CACHE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+
+/** Maximal count of different networks kept from one scan, the weakest are dropped. **/
+#ifndef EWC_SCAN_CACHE_SIZE
+#define EWC_SCAN_CACHE_SIZE 32
+#endif
+
+namespace EWC
+{
+  /** Result of the last completed WiFi scan.
+   * The results of the WiFi library are read once per scan: networks with the same SSID are merged
+   * by hash of the SSID keeping the access point with best RSSI, sorted by RSSI and serialized to JSON.
+   * The result of a single channel scan replaces the networks of this channel only, so a sweep over all
+   * channels fills the list step by step. The JSON is served until the next scan completes. **/
+  class ScanCache
+  {
+  public:
+    struct Network
+    {
+      uint32_t hash;
+      char ssid[33];
+      uint8_t bssid[6];
+      int8_t rssi;
+      uint8_t channel;
+      bool encrypted;
+    };
+
+    ScanCache();
+    /** Reads the results if a scan was completed since last call. Returns true if the cache was updated.
+     * Channel 0 replaces all networks, otherwise the networks of the channel are replaced.
+     * Set complete to false if further channels of the sweep follow. **/
+    bool update(uint8_t channel = 0, bool complete = true);
+    /** Count of completed sweeps since boot, 0 if no sweep was completed. **/
+    uint32_t generation() const { return _generation; }
+    size_t count() const { return _networks.size(); }
+    /** Networks sorted by RSSI, strongest first. **/
+    const Network &at(size_t index) const { return _networks[index]; }
+    /** Returns the index of the network with given SSID or -1. **/
+    int find(const String &ssid) const;
+    /** Serialized JSON of the networks: {"finished":true,"failed":false,"reason":"","networks":[...]}, empty if no scan was read.
+     * finished is false while further channels of the sweep follow. **/
+    const String &json() const { return _json; }
+    static uint32_t hash(const char *ssid);
+
+  protected:
+    uint32_t _generation;
+    std::vector<Network> _networks;
+    String _json;
+
+    void _serialize(bool complete);
+  };
+};
+#endif
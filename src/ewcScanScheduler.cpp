@@ -0,0 +1,98 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#include "ewcScanScheduler.h"
+
+using namespace EWC;
+
+ScanScheduler::ScanScheduler()
+    : _sweeping(false),
+      _scanning(false),
+      _swept(false),
+      _channel(ALL_CHANNELS),
+      _nextChannel(1),
+      _scanStart(0),
+      _scanEnd(0),
+      _sweepEnd(0),
+      _activity(0),
+      _sweeps(0)
+{
+}
+
+void ScanScheduler::request(uint32_t now, bool force)
+{
+  if (_sweeping || (!force && _swept && now - _sweepEnd < EWC_SCAN_INTERVAL_MS))
+  {
+    return;
+  }
+  _sweeping = true;
+  _nextChannel = 1;
+}
+
+void ScanScheduler::activity(uint32_t now)
+{
+  _activity = now;
+}
+
+int8_t ScanScheduler::next(uint32_t now, bool apClients)
+{
+  if (!_sweeping || _scanning)
+  {
+    return NO_SCAN;
+  }
+  if (apClients)
+  {
+    if (now - _activity < EWC_SCAN_IDLE_MS || now - _scanEnd < EWC_SCAN_CHANNEL_GAP_MS)
+    {
+      // the portal is in use, wait for an idle gap
+      return NO_SCAN;
+    }
+    _channel = _nextChannel++;
+  }
+  else if (_nextChannel == 1)
+  {
+    _channel = ALL_CHANNELS;
+  }
+  else
+  {
+    // the clients left during the sweep, continue without gaps
+    _channel = _nextChannel++;
+  }
+  _scanning = true;
+  _scanStart = now;
+  return _channel;
+}
+
+void ScanScheduler::finished(uint32_t now)
+{
+  if (!_scanning)
+  {
+    return;
+  }
+  _scanning = false;
+  _scanEnd = now;
+  if (lastOfSweep())
+  {
+    _sweeping = false;
+    _swept = true;
+    _sweepEnd = now;
+    _sweeps++;
+  }
+}
@@ -0,0 +1,102 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_SCAN_SCHEDULER_H
+#define EWC_SCAN_SCHEDULER_H
+
+/**
+ * Schedules the WiFi scans without disturbing the clients of the configuration portal.
+ * A scan takes the radio off the channel of the soft AP, so while clients are connected to the AP
+ * a sweep scans one channel at a time and only in idle gaps between HTTP requests.
+ * Without AP clients all channels are scanned at once.
+ * The scheduler has no dependency to the WiFi library, ConfigServer starts the returned scans
+ * and merges the results into the ScanCache.
+ */
+
+#include <stdint.h>
+
+/** Count of channels scanned one by one. **/
+#ifndef EWC_SCAN_CHANNELS
+#define EWC_SCAN_CHANNELS 13
+#endif
+/** Minimal time between the end of a sweep and the start of the next one. **/
+#ifndef EWC_SCAN_INTERVAL_MS
+#define EWC_SCAN_INTERVAL_MS 10000
+#endif
+/** Time without HTTP request before a channel is scanned while AP clients are connected. **/
+#ifndef EWC_SCAN_IDLE_MS
+#define EWC_SCAN_IDLE_MS 500
+#endif
+/** Minimal time between two channel scans while AP clients are connected. **/
+#ifndef EWC_SCAN_CHANNEL_GAP_MS
+#define EWC_SCAN_CHANNEL_GAP_MS 300
+#endif
+/** Time on each channel, used by ESP32 only. **/
+#ifndef EWC_SCAN_CHANNEL_DWELL_MS
+#define EWC_SCAN_CHANNEL_DWELL_MS 120
+#endif
+/** A scan without result after this time is dropped. **/
+#ifndef EWC_SCAN_TIMEOUT_MS
+#define EWC_SCAN_TIMEOUT_MS 15000
+#endif
+
+namespace EWC
+{
+  class ScanScheduler
+  {
+  public:
+    /** Returned by next() if no scan should be started. **/
+    static const int8_t NO_SCAN = -1;
+    /** Returned by next() to scan all channels. **/
+    static const int8_t ALL_CHANNELS = 0;
+
+    ScanScheduler();
+    /** Requests a sweep. Ignored while a sweep is running or if the last sweep ended less than EWC_SCAN_INTERVAL_MS before, except force is set. **/
+    void request(uint32_t now, bool force = false);
+    /** Called if an HTTP request was handled. **/
+    void activity(uint32_t now);
+    /** Returns the channel to scan now, ALL_CHANNELS or NO_SCAN. **/
+    int8_t next(uint32_t now, bool apClients);
+    /** Called after the result of the started scan was read or the scan failed. **/
+    void finished(uint32_t now);
+    /** True if the started scan runs longer than EWC_SCAN_TIMEOUT_MS. **/
+    bool timedOut(uint32_t now) const { return _scanning && now - _scanStart > EWC_SCAN_TIMEOUT_MS; }
+    bool sweeping() const { return _sweeping; }
+    bool scanning() const { return _scanning; }
+    /** Channel of the running scan, ALL_CHANNELS for a full scan. **/
+    uint8_t channel() const { return _channel; }
+    /** True if the running scan completes the sweep. **/
+    bool lastOfSweep() const { return _channel == ALL_CHANNELS || _channel >= EWC_SCAN_CHANNELS; }
+    uint32_t sweeps() const { return _sweeps; }
+
+  protected:
+    bool _sweeping;
+    bool _scanning;
+    bool _swept; //< true if a sweep was finished, _sweepEnd is valid
+    uint8_t _channel;
+    uint8_t _nextChannel;
+    uint32_t _scanStart;
+    uint32_t _scanEnd;
+    uint32_t _sweepEnd;
+    uint32_t _activity;
+    uint32_t _sweeps;
+  };
+};
+#endif
@@ -0,0 +1,140 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#include <string.h>
+#include "ewcSessionStore.h"
+
+using namespace EWC;
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+SessionStore::SessionStore(RandomFunction random)
+    : _random(random)
+{
+  clear();
+}
+
+void SessionStore::create(uint32_t now, char (&value)[VALUE_SIZE])
+{
+  // use a free or expired slot, otherwise replace the least recently used session
+  uint8_t slot = 0;
+  for (uint8_t i = 0; i < EWC_SESSIONS; i++)
+  {
+    if (_expired(_sessions[i], now))
+    {
+      slot = i;
+      break;
+    }
+    if (now - _sessions[i].lastUsed > now - _sessions[slot].lastUsed)
+    {
+      slot = i;
+    }
+  }
+  Session &session = _sessions[slot];
+  for (uint8_t i = 0; i < EWC_SESSION_TOKEN_SIZE; i += 4)
+  {
+    uint32_t r = _random();
+    memcpy(session.token + i, &r, 4);
+  }
+  session.used = true;
+  session.lastUsed = now;
+  value[0] = '0' + slot;
+  for (uint8_t i = 0; i < EWC_SESSION_TOKEN_SIZE; i++)
+  {
+    value[1 + 2 * i] = HEX_DIGITS[session.token[i] >> 4];
+    value[2 + 2 * i] = HEX_DIGITS[session.token[i] & 0x0F];
+  }
+  value[VALUE_SIZE - 1] = '\0';
+}
+
+bool SessionStore::check(const char *cookieHeader, uint32_t now)
+{
+  if (cookieHeader == nullptr)
+  {
+    return false;
+  }
+  const char *value = strstr(cookieHeader, EWC_SESSION_COOKIE "=");
+  if (value == nullptr)
+  {
+    return false;
+  }
+  value += sizeof(EWC_SESSION_COOKIE);
+  if (strlen(value) < VALUE_SIZE - 1 || value[0] < '0' || value[0] >= '0' + EWC_SESSIONS)
+  {
+    return false;
+  }
+  Session &session = _sessions[value[0] - '0'];
+  if (_expired(session, now))
+  {
+    return false;
+  }
+  // compare all bytes, the time does not depend on the position of the first difference
+  uint8_t diff = 0;
+  for (uint8_t i = 0; i < EWC_SESSION_TOKEN_SIZE; i++)
+  {
+    int8_t high = _hex(value[1 + 2 * i]);
+    int8_t low = _hex(value[2 + 2 * i]);
+    diff |= (uint8_t)(high | low) & 0xF0;
+    diff |= session.token[i] ^ (uint8_t)((high << 4) | (low & 0x0F));
+  }
+  if (diff != 0)
+  {
+    return false;
+  }
+  session.lastUsed = now;
+  return true;
+}
+
+void SessionStore::clear()
+{
+  memset(_sessions, 0, sizeof(_sessions));
+}
+
+uint8_t SessionStore::active(uint32_t now) const
+{
+  uint8_t count = 0;
+  for (const Session &session : _sessions)
+  {
+    if (!_expired(session, now))
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+bool SessionStore::_expired(const Session &session, uint32_t now) const
+{
+  return !session.used || now - session.lastUsed > EWC_SESSION_TTL_MS;
+}
+
+/** Returns the value of a lowercase hex digit or -1. **/
+int8_t SessionStore::_hex(char c)
+{
+  if (c >= '0' && c <= '9')
+  {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f')
+  {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
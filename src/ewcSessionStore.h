@@ -0,0 +1,81 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_SESSION_STORE_H
+#define EWC_SESSION_STORE_H
+
+/**
+ * Sessions created after a successful Basic authentication, so the following requests are
+ * authenticated by a cookie instead of decoding the Authorization header each time.
+ * The cookie value is the slot index followed by the random token in hex: the slot is found
+ * directly and the token compared in constant time. Sessions expire if they are not used
+ * for EWC_SESSION_TTL_MS, the oldest session is replaced if all slots are used.
+ * The clock is passed in and the random source injected, so the store can be tested on host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+/** Count of concurrent sessions. **/
+#ifndef EWC_SESSIONS
+#define EWC_SESSIONS 4
+#endif
+/** A session expires if not used for this time. **/
+#ifndef EWC_SESSION_TTL_MS
+#define EWC_SESSION_TTL_MS 1800000
+#endif
+#define EWC_SESSION_COOKIE "EWCSID"
+#define EWC_SESSION_TOKEN_SIZE 16
+
+namespace EWC
+{
+  class SessionStore
+  {
+  public:
+    typedef std::function<uint32_t()> RandomFunction;
+    /** Length of the cookie value: slot digit, token in hex and terminating zero. **/
+    static const size_t VALUE_SIZE = 1 + 2 * EWC_SESSION_TOKEN_SIZE + 1;
+
+    explicit SessionStore(RandomFunction random);
+    /** Creates a new session and writes the cookie value into value. **/
+    void create(uint32_t now, char (&value)[VALUE_SIZE]);
+    /** Returns true if the Cookie header contains a valid session, the expiry of the session is extended. **/
+    bool check(const char *cookieHeader, uint32_t now);
+    /** Invalidates all sessions, e.g. after the credentials have changed. **/
+    void clear();
+    /** Count of sessions not expired. **/
+    uint8_t active(uint32_t now) const;
+
+  protected:
+    struct Session
+    {
+      bool used;
+      uint32_t lastUsed;
+      uint8_t token[EWC_SESSION_TOKEN_SIZE];
+    };
+    RandomFunction _random;
+    Session _sessions[EWC_SESSIONS];
+
+    bool _expired(const Session &session, uint32_t now) const;
+    static int8_t _hex(char c);
+  };
+};
+#endif
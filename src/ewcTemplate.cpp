@@ -0,0 +1,63 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+
+#include "ewcTemplate.h"
+
+using namespace EWC;
+
+void PageTemplate::render(ResponseWriter &out, TemplateTokenFunction onToken) const
+{
+  PGM_P fragment = _page;
+  PGM_P pos = _page;
+  char c;
+  while ((c = pgm_read_byte(pos)) != '\0')
+  {
+    if (c != '{' || pgm_read_byte(pos + 1) != '{')
+    {
+      pos++;
+      continue;
+    }
+    // read the token name up to the closing marker
+    char token[EWC_TEMPLATE_TOKEN_SIZE + 1];
+    size_t len = 0;
+    PGM_P end = pos + 2;
+    while (len < EWC_TEMPLATE_TOKEN_SIZE && (c = pgm_read_byte(end)) != '\0' && c != '}')
+    {
+      token[len++] = c;
+      end++;
+    }
+    token[len] = '\0';
+    if (c != '}' || pgm_read_byte(end + 1) != '}')
+    {
+      // no valid marker, keep it as text
+      pos++;
+      continue;
+    }
+    out.writeP(fragment, pos - fragment);
+    if (!onToken(token, out))
+    {
+      out.writeP(pos, end + 2 - pos);
+    }
+    pos = end + 2;
+    fragment = pos;
+  }
+  out.writeP(fragment, pos - fragment);
+}
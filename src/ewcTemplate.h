@@ -0,0 +1,52 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_TEMPLATE_H
+#define EWC_TEMPLATE_H
+
+#include <Arduino.h>
+#include <functional>
+#include "ewcResponseWriter.h"
+
+/** Maximal length of a token name between the markers. **/
+#ifndef EWC_TEMPLATE_TOKEN_SIZE
+#define EWC_TEMPLATE_TOKEN_SIZE 16
+#endif
+
+namespace EWC
+{
+  /** Writes the value of the token to the response. Returns false if the token is unknown, the marker is then written unchanged. **/
+  typedef std::function<bool(const char *token, ResponseWriter &out)> TemplateTokenFunction;
+
+  /** Page in PROGMEM with {{TOKEN}} markers.
+   * The page is scanned once while it is written: the fragments between the markers are copied from flash
+   * to the response and for each marker the value is written by the callback. So neither the page nor
+   * the values are collected in the heap and the values can be of any size. **/
+  class PageTemplate
+  {
+  public:
+    explicit PageTemplate(PGM_P page) : _page(page) {}
+    void render(ResponseWriter &out, TemplateTokenFunction onToken) const;
+
+  protected:
+    PGM_P _page;
+  };
+};
+#endif
@@ -0,0 +1,52 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_VERSION_TAG_H
+#define EWC_VERSION_TAG_H
+
+#include <Arduino.h>
+
+namespace EWC
+{
+  /** Cheap FNV-1a hash over the values a response is built from.
+   * Used as version of dynamic content, e.g. for the ETag of state responses. **/
+  class VersionTag
+  {
+  public:
+    VersionTag() : _hash(2166136261UL) {}
+    VersionTag &add(const void *data, size_t len)
+    {
+      const uint8_t *bytes = static_cast<const uint8_t *>(data);
+      for (size_t i = 0; i < len; i++)
+      {
+        _hash ^= bytes[i];
+        _hash *= 16777619UL;
+      }
+      return *this;
+    }
+    VersionTag &add(uint32_t value) { return add(&value, sizeof(value)); }
+    VersionTag &add(const String &value) { return add(value.c_str(), value.length() + 1); }
+    uint32_t value() const { return _hash; }
+
+  protected:
+    uint32_t _hash;
+  };
+};
+#endif
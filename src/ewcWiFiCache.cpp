@@ -0,0 +1,111 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#include <LittleFS.h>
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+#include "ewcWiFiCache.h"
+#include "ewcInterface.h"
+#include "ewcVersionTag.h"
+
+using namespace EWC;
+
+/** Identifies the layout of the cache file, change on modification of Data. **/
+#define WIFI_CACHE_MAGIC 0x45574331UL
+
+WiFiCache::WiFiCache()
+{
+  memset(&_data, 0, sizeof(_data));
+}
+
+uint32_t WiFiCache::_hash(const String &ssid)
+{
+  return VersionTag().add(ssid).value();
+}
+
+void WiFiCache::load()
+{
+  memset(&_data, 0, sizeof(_data));
+  File file = LittleFS.open(FPSTR(WIFI_CACHE_FILENAME), "r");
+  if (!file || file.isDirectory())
+  {
+    return;
+  }
+  if (file.read(reinterpret_cast<uint8_t *>(&_data), sizeof(_data)) != sizeof(_data) || _data.magic != WIFI_CACHE_MAGIC)
+  {
+    I::get().logger() << F("✘ [EWC WiFiCache]: ignore invalid ") << FPSTR(WIFI_CACHE_FILENAME) << endl;
+    memset(&_data, 0, sizeof(_data));
+  }
+  file.close();
+}
+
+void WiFiCache::update(const String &ssid, bool useLease)
+{
+  Data data;
+  memset(&data, 0, sizeof(data));
+  data.magic = WIFI_CACHE_MAGIC;
+  data.ssidHash = _hash(ssid);
+  memcpy(data.bssid, WiFi.BSSID(), sizeof(data.bssid));
+  data.channel = WiFi.channel();
+  if (useLease)
+  {
+    data.ip = WiFi.localIP();
+    data.gateway = WiFi.gatewayIP();
+    data.netmask = WiFi.subnetMask();
+    data.dns1 = WiFi.dnsIP(0);
+    data.dns2 = WiFi.dnsIP(1);
+  }
+  if (memcmp(&data, &_data, sizeof(data)) != 0)
+  {
+    _data = data;
+    _save();
+  }
+}
+
+void WiFiCache::clear()
+{
+  if (_data.magic == WIFI_CACHE_MAGIC)
+  {
+    I::get().logger() << F("[EWC WiFiCache]: clear") << endl;
+    memset(&_data, 0, sizeof(_data));
+    LittleFS.remove(FPSTR(WIFI_CACHE_FILENAME));
+  }
+}
+
+bool WiFiCache::valid(const String &ssid) const
+{
+  return _data.magic == WIFI_CACHE_MAGIC && _data.channel > 0 && _data.ssidHash == _hash(ssid);
+}
+
+void WiFiCache::_save()
+{
+  I::get().logger() << F("[EWC WiFiCache]: save channel ") << (uint32_t)_data.channel << F(", lease: ") << hasLease() << endl;
+  File file = LittleFS.open(FPSTR(WIFI_CACHE_FILENAME), "w");
+  if (!file)
+  {
+    I::get().logger() << F("✘ [EWC WiFiCache]: can not write ") << FPSTR(WIFI_CACHE_FILENAME) << endl;
+    return;
+  }
+  file.write(reinterpret_cast<const uint8_t *>(&_data), sizeof(_data));
+  file.close();
+}
@@ -0,0 +1,82 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_WIFI_CACHE_H
+#define EWC_WIFI_CACHE_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+/** Time for a connect with cached BSSID and channel before falling back to a full scan. **/
+#ifndef EWC_WIFI_FAST_TIMEOUT_MS
+#define EWC_WIFI_FAST_TIMEOUT_MS 5000
+#endif
+
+namespace EWC
+{
+  const char WIFI_CACHE_FILENAME[] PROGMEM = "/wifi.cache";
+
+  /** Parameter of the last successful connection, stored in LittleFS.
+   * The next connect uses them as hints to skip the channel scan and (optionally) DHCP.
+   * The file is only written if a value changed. **/
+  class WiFiCache
+  {
+  public:
+    WiFiCache();
+
+    /** Reads the cache file. LittleFS must be mounted. **/
+    void load();
+    /** Stores the parameter of current connection. The lease is stored only if useLease is true. **/
+    void update(const String &ssid, bool useLease);
+    /** Removes the cached values, e.g. after a failed fast connect or on new credentials. **/
+    void clear();
+    /** True if the cache contains a connection to given SSID. **/
+    bool valid(const String &ssid) const;
+    bool hasLease() const { return _data.ip != 0; }
+
+    const uint8_t *bssid() const { return _data.bssid; }
+    int32_t channel() const { return _data.channel; }
+    IPAddress ip() const { return IPAddress(_data.ip); }
+    IPAddress gateway() const { return IPAddress(_data.gateway); }
+    IPAddress netmask() const { return IPAddress(_data.netmask); }
+    IPAddress dns1() const { return IPAddress(_data.dns1); }
+    IPAddress dns2() const { return IPAddress(_data.dns2); }
+
+  protected:
+    struct Data
+    {
+      uint32_t magic;
+      uint32_t ssidHash;
+      uint8_t bssid[6];
+      uint8_t channel;
+      uint8_t reserved;
+      uint32_t ip;
+      uint32_t gateway;
+      uint32_t netmask;
+      uint32_t dns1;
+      uint32_t dns2;
+    };
+    Data _data;
+
+    static uint32_t _hash(const String &ssid);
+    void _save();
+  };
+};
+#endif
@@ -0,0 +1,107 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#include <algorithm>
+#include "ewcWiFiNetworks.h"
+
+using namespace EWC;
+
+void WiFiNetworks::add(const String &ssid, const String &pass)
+{
+  if (ssid.isEmpty())
+  {
+    return;
+  }
+  remove(ssid);
+  if (_networks.size() >= EWC_WIFI_NETWORKS)
+  {
+    _networks.pop_back();
+  }
+  _networks.insert(_networks.begin(), Credential{ssid, pass});
+}
+
+bool WiFiNetworks::remove(const String &ssid)
+{
+  int index = find(ssid);
+  if (index < 0)
+  {
+    return false;
+  }
+  _networks.erase(_networks.begin() + index);
+  return true;
+}
+
+int WiFiNetworks::find(const String &ssid) const
+{
+  for (size_t i = 0; i < _networks.size(); i++)
+  {
+    if (_networks[i].ssid == ssid)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+std::vector<uint8_t> WiFiNetworks::rank(const ScanCache &scan) const
+{
+  std::vector<uint8_t> result;
+  std::vector<int> rssi;
+  result.reserve(_networks.size());
+  rssi.reserve(_networks.size());
+  for (size_t i = 0; i < _networks.size(); i++)
+  {
+    int found = scan.find(_networks[i].ssid);
+    result.push_back(i);
+    // not found networks after all found
+    rssi.push_back(found < 0 ? INT16_MIN : scan.at(found).rssi);
+  }
+  // stable: keeps the order of the list for same RSSI and the not found networks
+  std::stable_sort(result.begin(), result.end(), [&rssi](uint8_t a, uint8_t b)
+                   { return rssi[a] > rssi[b]; });
+  return result;
+}
+
+void WiFiNetworks::fromJson(JsonVariantConst json)
+{
+  if (json.isNull())
+  {
+    return;
+  }
+  _networks.clear();
+  for (JsonVariantConst network : json.as<JsonArrayConst>())
+  {
+    String ssid = network["ssid"] | "";
+    if (!ssid.isEmpty() && _networks.size() < EWC_WIFI_NETWORKS && find(ssid) < 0)
+    {
+      _networks.push_back(Credential{ssid, network["pass"] | ""});
+    }
+  }
+}
+
+void WiFiNetworks::toJson(JsonArray json) const
+{
+  for (const Credential &network : _networks)
+  {
+    JsonObject entry = json.add<JsonObject>();
+    entry["ssid"] = network.ssid;
+    entry["pass"] = network.pass;
+  }
+}
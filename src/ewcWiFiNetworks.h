@@ -0,0 +1,66 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_WIFI_NETWORKS_H
+#define EWC_WIFI_NETWORKS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include "ewcScanCache.h"
+
+/** Maximal count of stored networks, the oldest is removed on add. **/
+#ifndef EWC_WIFI_NETWORKS
+#define EWC_WIFI_NETWORKS 5
+#endif
+
+namespace EWC
+{
+  /** Ordered list of known networks, the last added first.
+   * Stored in the "networks" array of the "ewc" configuration section. **/
+  class WiFiNetworks
+  {
+  public:
+    struct Credential
+    {
+      String ssid;
+      String pass;
+    };
+
+    /** Adds the network in front of the list or moves it there and updates the passphrase. **/
+    void add(const String &ssid, const String &pass);
+    /** Returns false if the network is not in the list. **/
+    bool remove(const String &ssid);
+    void clear() { _networks.clear(); }
+    size_t count() const { return _networks.size(); }
+    const Credential &at(size_t index) const { return _networks[index]; }
+    int find(const String &ssid) const;
+    /** Returns indexes of the networks to try: networks found in the scan sorted by RSSI,
+     * followed by the not found networks in order of the list (hidden or not scanned). **/
+    std::vector<uint8_t> rank(const ScanCache &scan) const;
+
+    void fromJson(JsonVariantConst json);
+    void toJson(JsonArray json) const;
+
+  protected:
+    std::vector<Credential> _networks;
+  };
+};
+#endif
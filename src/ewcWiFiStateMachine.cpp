@@ -0,0 +1,224 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#include "ewcWiFiStateMachine.h"
+
+using namespace EWC;
+
+/** Transitions of the station, first matching rule wins. Not listed events are ignored. **/
+const WiFiStateMachine::Rule WiFiStateMachine::RULES[] = {
+    {ANY, EV_BEGIN, CONNECTING, ACT_CONNECT, DL_CONNECT},
+    {CONNECTING, EV_RETRY, CONNECTING, ACT_CONNECT, DL_CONNECT},
+    {BACKOFF, EV_RETRY, CONNECTING, ACT_CONNECT, DL_CONNECT},
+    {CONNECTED, EV_CONNECTED, SAME, ACT_NONE, DL_NONE},
+    {ANY, EV_CONNECTED, CONNECTED, ACT_CONNECTED, DL_NONE},
+    {CONNECTING, EV_DISCONNECTED, BACKOFF, ACT_START_AP, DL_BACKOFF},
+    {CONNECTED, EV_DISCONNECTED, BACKOFF, ACT_START_AP, DL_BACKOFF},
+    {CONNECTING, EV_TIMEOUT, BACKOFF, ACT_START_AP, DL_BACKOFF},
+    {BACKOFF, EV_TIMEOUT, CONNECTING, ACT_CONNECT, DL_CONNECT},
+    {ANY, EV_NO_SSID, SAME, ACT_START_AP, DL_KEEP},
+    {ANY, EV_STOP, IDLE, ACT_NONE, DL_NONE},
+};
+
+static const char *const STATE_NAMES[] = {"idle", "connecting", "connected", "backoff"};
+static const char *const EVENT_NAMES[] = {"begin", "retry", "connected", "disconnected", "timeout", "no_ssid", "stop", "portal_timeout"};
+static const char *const PORTAL_NAMES[] = {"off", "on", "timed_out"};
+
+WiFiStateMachine::WiFiStateMachine(ClockFunction clock, RandomFunction random)
+    : _clock(clock),
+      _random(random),
+      _state(IDLE),
+      _portal(PORTAL_OFF),
+      _portalAlways(false),
+      _attempts(0),
+      _connectTimeout(60000),
+      _portalTimeout(300000),
+      _backoffMin(EWC_WIFI_BACKOFF_MIN_MS),
+      _backoffMax(EWC_WIFI_BACKOFF_MAX_MS),
+      _deadlineActive(false),
+      _deadline(0),
+      _portalStart(0),
+      _traceNext(0),
+      _traceCount(0)
+{
+}
+
+void WiFiStateMachine::setBackoff(uint32_t minMs, uint32_t maxMs)
+{
+  _backoffMin = minMs > 0 ? minMs : 1;
+  _backoffMax = maxMs > _backoffMin ? maxMs : _backoffMin;
+}
+
+uint8_t WiFiStateMachine::handle(Event event, uint8_t reason)
+{
+  const Rule *rule = nullptr;
+  for (const Rule &r : RULES)
+  {
+    if ((r.from == ANY || r.from == _state) && r.event == event)
+    {
+      rule = &r;
+      break;
+    }
+  }
+  if (rule == nullptr)
+  {
+    return ACT_NONE;
+  }
+  uint32_t now = _clock();
+  State from = _state;
+  State to = rule->to == SAME ? _state : static_cast<State>(rule->to);
+  uint8_t actions = rule->actions;
+  if (_portal != PORTAL_OFF)
+  {
+    // the portal is already running or disabled after timeout
+    actions &= ~ACT_START_AP;
+  }
+  if (to == CONNECTED || event == EV_BEGIN)
+  {
+    _attempts = 0;
+  }
+  if (to == CONNECTED && _portal == PORTAL_TIMED_OUT)
+  {
+    _portal = PORTAL_OFF;
+  }
+  switch (rule->deadline)
+  {
+  case DL_NONE:
+    _deadlineActive = false;
+    break;
+  case DL_KEEP:
+    break;
+  case DL_CONNECT:
+    _deadlineActive = _connectTimeout > 0;
+    _deadline = now + _connectTimeout;
+    break;
+  case DL_BACKOFF:
+    _attempts++;
+    _deadlineActive = true;
+    _deadline = now + _backoffWithJitter();
+    break;
+  }
+  _state = to;
+  if (from != to || actions != ACT_NONE)
+  {
+    _record(now, from, to, event, reason);
+  }
+  return actions;
+}
+
+uint8_t WiFiStateMachine::poll(bool portalIdle)
+{
+  uint8_t actions = ACT_NONE;
+  uint32_t now = _clock();
+  if (_deadlineActive && _reached(now, _deadline))
+  {
+    _deadlineActive = false;
+    actions |= handle(EV_TIMEOUT);
+  }
+  if (_portal == PORTAL_ON && !_portalAlways && _portalTimeout > 0 && portalIdle && _reached(now, _portalStart + _portalTimeout))
+  {
+    _portal = PORTAL_TIMED_OUT;
+    _record(now, _state, _state, EV_PORTAL_TIMEOUT, 0);
+    actions |= ACT_STOP_AP;
+  }
+  return actions;
+}
+
+void WiFiStateMachine::portalStarted(bool always)
+{
+  _portal = PORTAL_ON;
+  _portalAlways = always;
+  _portalStart = _clock();
+}
+
+void WiFiStateMachine::portalStopped()
+{
+  if (_portal == PORTAL_ON)
+  {
+    _portal = PORTAL_OFF;
+  }
+}
+
+uint32_t WiFiStateMachine::remaining() const
+{
+  if (!_deadlineActive)
+  {
+    return 0;
+  }
+  uint32_t now = _clock();
+  return _reached(now, _deadline) ? 0 : _deadline - now;
+}
+
+uint32_t WiFiStateMachine::backoff(uint32_t attempts) const
+{
+  uint32_t delay = _backoffMin;
+  for (uint32_t i = 1; i < attempts && delay < _backoffMax; i++)
+  {
+    delay = delay > _backoffMax / 2 ? _backoffMax : delay * 2;
+  }
+  return delay < _backoffMax ? delay : _backoffMax;
+}
+
+uint32_t WiFiStateMachine::_backoffWithJitter()
+{
+  uint32_t delay = backoff(_attempts);
+  if (_random)
+  {
+    // equal jitter: keep half of the delay, randomize the other half
+    uint32_t half = delay / 2;
+    delay = half + _random() % (delay - half + 1);
+  }
+  return delay;
+}
+
+void WiFiStateMachine::_record(uint32_t now, State from, State to, Event event, uint8_t reason)
+{
+  Transition &t = _trace[_traceNext];
+  t.ts = now;
+  t.from = from;
+  t.to = to;
+  t.event = event;
+  t.reason = reason;
+  _traceNext = (_traceNext + 1) % EWC_WIFI_TRACE_SIZE;
+  if (_traceCount < EWC_WIFI_TRACE_SIZE)
+  {
+    _traceCount++;
+  }
+}
+
+const WiFiStateMachine::Transition &WiFiStateMachine::trace(uint8_t index) const
+{
+  return _trace[(_traceNext + EWC_WIFI_TRACE_SIZE - _traceCount + index) % EWC_WIFI_TRACE_SIZE];
+}
+
+const char *WiFiStateMachine::stateName(State state)
+{
+  return state < STATE_COUNT ? STATE_NAMES[state] : "?";
+}
+
+const char *WiFiStateMachine::eventName(Event event)
+{
+  return event < EVENT_COUNT ? EVENT_NAMES[event] : "?";
+}
+
+const char *WiFiStateMachine::portalName(Portal portal)
+{
+  return portal <= PORTAL_TIMED_OUT ? PORTAL_NAMES[portal] : "?";
+}
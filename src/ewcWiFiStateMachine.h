@@ -0,0 +1,177 @@
+/**************************************************************
+
+This file is a part of
+https://github.com/atiderko/espwebconfig
+
+Copyright [2020] Alexander Tiderko
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+**************************************************************/
+#ifndef EWC_WIFI_STATE_MACHINE_H
+#define EWC_WIFI_STATE_MACHINE_H
+
+/**
+ * Connection state machine of the WiFi station and the configuration portal.
+ * The machine has no dependency to the WiFi library: the ConfigServer feeds
+ * events by handle(), checks the deadlines by poll() and executes the returned actions.
+ * The clock and the random source are injected, so the transitions can be tested on host.
+ *
+ * Reconnects are delayed by exponential backoff with jitter, so devices behind the same
+ * access point do not reconnect in sync after an outage.
+ */
+
+#include <stdint.h>
+#include <functional>
+
+/** Delay of the first reconnect, doubled on each failed attempt. **/
+#ifndef EWC_WIFI_BACKOFF_MIN_MS
+#define EWC_WIFI_BACKOFF_MIN_MS 10000
+#endif
+/** Upper limit of the reconnect delay. **/
+#ifndef EWC_WIFI_BACKOFF_MAX_MS
+#define EWC_WIFI_BACKOFF_MAX_MS 300000
+#endif
+/** Count of transitions kept for /wifi/trace.json. **/
+#ifndef EWC_WIFI_TRACE_SIZE
+#define EWC_WIFI_TRACE_SIZE 16
+#endif
+
+namespace EWC
+{
+  class WiFiStateMachine
+  {
+  public:
+    enum State : uint8_t
+    {
+      IDLE,
+      CONNECTING,
+      CONNECTED,
+      BACKOFF,
+      STATE_COUNT
+    };
+    enum Event : uint8_t
+    {
+      EV_BEGIN,        //< connect with new or saved credentials
+      EV_RETRY,        //< connect again without backoff, e.g. after a failed fast connect
+      EV_CONNECTED,    //< station got IP
+      EV_DISCONNECTED, //< station lost or failed the connection, reason is the disconnect reason of the WiFi event
+      EV_TIMEOUT,      //< deadline of the state expired, generated by poll()
+      EV_NO_SSID,      //< no credentials available
+      EV_STOP,         //< disconnected by user, no reconnect
+      EV_PORTAL_TIMEOUT,
+      EVENT_COUNT
+    };
+    /** Bits of the actions returned by handle() and poll(). **/
+    enum Action : uint8_t
+    {
+      ACT_NONE = 0,
+      ACT_CONNECT = 1,
+      ACT_START_AP = 2,
+      ACT_STOP_AP = 4,
+      ACT_CONNECTED = 8
+    };
+    enum Portal : uint8_t
+    {
+      PORTAL_OFF,
+      PORTAL_ON,
+      PORTAL_TIMED_OUT //< disabled until next connect or reboot
+    };
+    struct Transition
+    {
+      uint32_t ts;
+      State from;
+      State to;
+      Event event;
+      uint8_t reason;
+    };
+    typedef std::function<uint32_t()> ClockFunction;
+    typedef std::function<uint32_t()> RandomFunction;
+
+    /** Without random function the backoff has no jitter. **/
+    WiFiStateMachine(ClockFunction clock, RandomFunction random = nullptr);
+
+    void setConnectTimeout(uint32_t ms) { _connectTimeout = ms; }
+    /** 0 disables the timeout of the portal. **/
+    void setPortalTimeout(uint32_t ms) { _portalTimeout = ms; }
+    void setBackoff(uint32_t minMs, uint32_t maxMs);
+
+    /** Feeds an event and returns the actions to execute. **/
+    uint8_t handle(Event event, uint8_t reason = 0);
+    /** Checks the deadlines. The portal is only disabled if portalIdle (no client connected to AP). **/
+    uint8_t poll(bool portalIdle);
+    /** Called if the AP was started, always: AP is never disabled by timeout. **/
+    void portalStarted(bool always);
+    void portalStopped();
+
+    State state() const { return _state; }
+    Portal portal() const { return _portal; }
+    uint32_t attempts() const { return _attempts; }
+    /** Milliseconds until the deadline of current state, 0 without deadline. **/
+    uint32_t remaining() const;
+    /** Delay before reconnect after given count of failed attempts, without jitter. **/
+    uint32_t backoff(uint32_t attempts) const;
+
+    uint8_t traceCount() const { return _traceCount; }
+    /** Transition at index, 0 is the oldest. **/
+    const Transition &trace(uint8_t index) const;
+
+    static const char *stateName(State state);
+    static const char *eventName(Event event);
+    static const char *portalName(Portal portal);
+
+  protected:
+    /** Deadline set on transition. **/
+    enum Deadline : uint8_t
+    {
+      DL_NONE,
+      DL_KEEP,
+      DL_CONNECT,
+      DL_BACKOFF
+    };
+    struct Rule
+    {
+      uint8_t from; //< State or ANY
+      Event event;
+      uint8_t to; //< State or SAME
+      uint8_t actions;
+      Deadline deadline;
+    };
+    static const uint8_t ANY = 0xFF;
+    static const uint8_t SAME = 0xFF;
+    static const Rule RULES[];
+
+    ClockFunction _clock;
+    RandomFunction _random;
+    State _state;
+    Portal _portal;
+    bool _portalAlways;
+    uint32_t _attempts;
+    uint32_t _connectTimeout;
+    uint32_t _portalTimeout;
+    uint32_t _backoffMin;
+    uint32_t _backoffMax;
+    bool _deadlineActive;
+    uint32_t _deadline;
+    uint32_t _portalStart;
+    Transition _trace[EWC_WIFI_TRACE_SIZE];
+    uint8_t _traceNext;
+    uint8_t _traceCount;
+
+    /** Rollover safe: true if now is at or after ts. **/
+    static bool _reached(uint32_t now, uint32_t ts) { return (int32_t)(now - ts) >= 0; }
+    uint32_t _backoffWithJitter();
+    void _record(uint32_t now, State from, State to, Event event, uint8_t reason);
+  };
+};
+#endif
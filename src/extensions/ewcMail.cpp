@@ -21,26 +21,32 @@ limitations under the License.
 #include "ewcMail.h"
 #include "ewcTime.h"
 #include <ewcConfigServer.h>
+#include "../generated/ewcMailAssets.h"
+#include <ewcVersionTag.h>
+#include <ewcProfiler.h>
 #include <vector>
-#include "generated/mailSetupHTML.h"
-#include "generated/mailStateHTML.h"
 
 using namespace EWC;
 
+const Param<Mail> Mail::PARAM_LIST[] = {
+    paramBool<Mail>("on_warning", &Mail::_mailOnWarning, true),
+    paramBool<Mail>("on_change", &Mail::_mailOnChange, true),
+    paramBool<Mail>("on_event", &Mail::_mailOnEvent, false),
+    paramString<Mail>("smtp", &Mail::_mailServer, DEFAULT_MAIL_SMTP, PARAM_FORM_NON_EMPTY),
+    paramUInt16<Mail>("port", &Mail::_mailPort, DEFAULT_MAIL_SMTP_PORT, 1, UINT16_MAX),
+    paramString<Mail>("sender", &Mail::_mailSender, DEFAULT_MAIL_SENDER, PARAM_FORM_NON_EMPTY),
+    paramString<Mail>("passphrase", &Mail::_mailPassword, DEFAULT_MAIL_SENDER_PW, PARAM_SECRET),
+    paramString<Mail>("receiver", &Mail::_mailReceiver, DEFAULT_MAIL_RECEIVER, PARAM_FORM_NON_EMPTY),
+};
+const ParamTable<Mail> Mail::PARAMS(Mail::PARAM_LIST);
+
 Mail::Mail()
     : ConfigInterface("mail")
 {
   _tsSendMail = 0;
   _testMailSend = false;
   _testMailSuccess = false;
-  _mailOnWarning = true;
-  _mailOnChange = true;
-  _mailOnEvent = false;
-  _mailServer = DEFAULT_MAIL_SMTP;
-  _mailPort = DEFAULT_MAIL_SMTP_PORT;
-  _mailSender = DEFAULT_MAIL_SENDER;
-  _mailPassword = DEFAULT_MAIL_SENDER_PW;
-  _mailReceiver = DEFAULT_MAIL_RECEIVER;
+  PARAMS.init(*this);
 }
 
 Mail::~Mail()
@@ -52,16 +58,18 @@ void Mail::setup(JsonDocument &config, bool resetConfig)
   // email settings
   _fromJson(config);
   WebServer *ws = &EWC::I::get().server().webServer();
-  EWC::I::get().server().insertMenuG("Mail", "/mail/setup", "menu_mail", FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_MAIL_SETUP_GZIP, sizeof(HTML_MAIL_SETUP_GZIP), true, 0);
-  EWC::I::get().server().webServer().on("/mail/config.json", std::bind(&Mail::_onMailConfig, this, ws));
+  EWC::I::get().server().addAssets(EWC_MAIL_ASSETS);
+  EWC::I::get().server().insertMenuA("Mail", "/mail/setup", "menu_mail", true, 0);
+  EWC::I::get().server().addJsonProducer("mail_config", "/mail/config.json", std::bind(&Mail::_fillMailConfig, this, std::placeholders::_1), true);
   EWC::I::get().server().webServer().on("/mail/config/save", std::bind(&Mail::_onMailSave, this, ws, true));
   EWC::I::get().server().webServer().on("/mail/test", std::bind(&Mail::_onMailTest, this, ws));
-  EWC::I::get().server().webServer().on("/mail/state.html", std::bind(&ConfigServer::sendContentG, &EWC::I::get().server(), ws, FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_MAIL_STATE_GZIP, sizeof(HTML_MAIL_STATE_GZIP)));
-  EWC::I::get().server().webServer().on("/mail/state.json", std::bind(&Mail::_onMailState, this, ws));
+  EWC::I::get().server().enableAsset("/mail/state.html");
+  EWC::I::get().server().addJsonProducer("mail_state", "/mail/state.json", std::bind(&Mail::_fillMailState, this, std::placeholders::_1), false, std::bind(&Mail::_mailStateVersion, this));
 }
 
 void Mail::loop()
 {
+  EWC_PROFILE_SCOPE("mail.loop");
   if (!enabled() && !I::get().server().isConnected())
     return;
 
@@ -136,92 +144,45 @@ void Mail::loop()
 
 void Mail::fillJson(JsonDocument &config)
 {
-  config["mail"]["on_warning"] = _mailOnWarning;
-  config["mail"]["on_change"] = _mailOnChange;
-  config["mail"]["on_event"] = _mailOnEvent;
-  config["mail"]["smtp"] = _mailServer;
-  config["mail"]["port"] = _mailPort;
-  config["mail"]["sender"] = _mailSender;
-  config["mail"]["passphrase"] = _mailPassword;
-  config["mail"]["receiver"] = _mailReceiver;
+  PARAMS.toJson(*this, config["mail"].to<JsonObject>());
+}
+
+void Mail::removeSecrets(JsonDocument &config)
+{
+  PARAMS.removeSecrets(config["mail"]);
 }
 
 void Mail::_fromJson(JsonDocument &config)
 {
-  JsonVariant jv = config["mail"]["on_warning"];
-  if (!jv.isNull())
-  {
-    _mailOnWarning = jv.as<bool>();
-  }
-  jv = config["mail"]["on_change"];
-  if (!jv.isNull())
-  {
-    _mailOnChange = jv.as<bool>();
-  }
-  jv = config["mail"]["on_event"];
-  if (!jv.isNull())
-  {
-    _mailOnEvent = jv.as<bool>();
-  }
-  jv = config["mail"]["smtp"];
-  if (!jv.isNull())
-  {
-    _mailServer = jv.as<String>();
-  }
-  jv = config["mail"]["port"];
-  if (!jv.isNull())
-  {
-    _mailPort = jv.as<int>();
-  }
-  jv = config["mail"]["sender"];
-  if (!jv.isNull())
-  {
-    _mailSender = jv.as<String>();
-  }
-  jv = config["mail"]["passphrase"];
-  if (!jv.isNull())
-  {
-    _mailPassword = jv.as<String>();
-  }
-  jv = config["mail"]["receiver"];
-  if (!jv.isNull())
-  {
-    _mailReceiver = jv.as<String>();
-  }
+  PARAMS.fromJson(*this, config["mail"]);
   _mailConfig = MailConfig(_mailServer, _mailSender, _mailPassword, _mailReceiver);
 }
 
-void Mail::_onMailConfig(WebServer *webServer)
+void Mail::_fillMailConfig(JsonDocument &jsonDoc)
 {
   I::get().logger() << F("[Mail] config request") << endl;
-  if (!I::get().server().isAuthenticated(webServer))
-  {
-    I::get().logger() << F("[Mail] not sufficient authentication") << endl;
-    return webServer->requestAuthentication();
-  }
-  JsonDocument jsonDoc;
-  fillJson(jsonDoc);
-  String output;
-  serializeJson(jsonDoc, output);
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
+  // the password is not sent to the browser
+  PARAMS.toJson(*this, jsonDoc["mail"].to<JsonObject>(), false);
 }
 
-void Mail::_onMailState(WebServer *webServer)
+/** Version of the values reported by _fillMailState(). **/
+uint32_t Mail::_mailStateVersion()
+{
+  return VersionTag()
+      .add(_testMailSend)
+      .add(_testMailSuccess)
+      .add(_testMailResult)
+      .add(_mailData.length() > 0)
+      .value();
+}
+
+void Mail::_fillMailState(JsonDocument &jsonDoc)
 {
   I::get().logger() << F("[Mail] state request") << endl;
-  if (!I::get().server().isAuthenticated(webServer))
-  {
-    I::get().logger() << F("[Mail] not sufficient authentication") << endl;
-    return webServer->requestAuthentication();
-  }
-  JsonDocument jsonDoc;
   jsonDoc["mail"]["test_send"] = _testMailSend;
   jsonDoc["mail"]["test_success"] = _testMailSuccess;
   jsonDoc["mail"]["test_result"] = _testMailResult;
   jsonDoc["mail"]["sending"] = _mailData.length() > 0;
-  String output;
-  serializeJson(jsonDoc, output);
-  webServer->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
 }
 
 void Mail::_onMailSave(WebServer *webServer, bool sendResponse)
@@ -233,61 +194,13 @@ void Mail::_onMailSave(WebServer *webServer, bool sendResponse)
     return webServer->requestAuthentication();
   }
   JsonDocument config;
-  if (webServer->hasArg("on_warning"))
-  {
-    config["mail"]["on_warning"] = webServer->arg("on_warning").equals("true");
-  }
-  else
-  {
-    config["mail"]["on_warning"] = false;
-  }
-  if (webServer->hasArg("on_change"))
-  {
-    config["mail"]["on_change"] = webServer->arg("on_change").equals("true");
-  }
-  else
-  {
-    config["mail"]["on_change"] = false;
-  }
-  if (webServer->hasArg("on_event"))
-  {
-    config["mail"]["on_event"] = webServer->arg("on_event").equals("true");
-  }
-  else
-  {
-    config["mail"]["on_event"] = false;
-  }
-  if (webServer->hasArg("smtp") && !webServer->arg("smtp").isEmpty())
-  {
-    config["mail"]["smtp"] = webServer->arg("smtp");
-  }
-  if (webServer->hasArg("port"))
-  {
-    long val = webServer->arg("port").toInt();
-    if (val > 0)
-    {
-      config["mail"]["port"] = val;
-    }
-  }
-  if (webServer->hasArg("sender") && !webServer->arg("sender").isEmpty())
-  {
-    config["mail"]["sender"] = webServer->arg("sender");
-  }
-  if (webServer->hasArg("passphrase") && !webServer->arg("passphrase").isEmpty())
-  {
-    config["mail"]["passphrase"] = webServer->arg("passphrase");
-  }
-  if (webServer->hasArg("receiver") && !webServer->arg("receiver").isEmpty())
-  {
-    config["mail"]["receiver"] = webServer->arg("receiver");
-  }
+  PARAMS.fromForm(webServer, config["mail"].to<JsonObject>());
   _fromJson(config);
-  I::get().configFS().save();
+  I::get().configFS().save(*this);
   if (sendResponse)
   {
-    String details;
-    serializeJsonPretty(config["mail"], details);
-    I::get().server().sendPageSuccess(webServer, "BBS Mail save", "Save successful!", "/mail/setup", "<pre id=\"json\">" + details + "</pre>", "Back", "/mail/test", "Send Test Mail");
+    removeSecrets(config);
+    I::get().server().sendPageSuccessJson(webServer, "BBS Mail save", "Save successful!", "/mail/setup", config["mail"], "Back", "/mail/test", "Send Test Mail");
   }
 }
 
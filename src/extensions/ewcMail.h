@@ -30,6 +30,7 @@ limitations under the License.
 #include <vector>
 #endif
 #include <Base64.h>
+#include "../ewcParam.h"
 
 namespace EWC
 {
@@ -74,6 +75,7 @@ namespace EWC
     /** === ConfigInterface Methods === **/
     void setup(JsonDocument &config, bool resetConfig = false);
     void fillJson(JsonDocument &config);
+    void removeSecrets(JsonDocument &config);
 
     /** === OWN Methods === **/
     void loop();
@@ -95,7 +97,9 @@ namespace EWC
     MailConfig _mailConfig;
     String _mailData;
 
-    // mail configuration parameter
+    // mail configuration parameter, described by PARAMS
+    static const Param<Mail> PARAM_LIST[];
+    static const ParamTable<Mail> PARAMS;
     boolean _mailOnWarning;
     boolean _mailOnChange;
     boolean _mailOnEvent;
@@ -105,8 +109,9 @@ namespace EWC
     String _mailPassword;
     String _mailReceiver;
 
-    void _onMailConfig(WebServer *webServer);
-    void _onMailState(WebServer *webServer);
+    void _fillMailConfig(JsonDocument &jsonDoc);
+    void _fillMailState(JsonDocument &jsonDoc);
+    uint32_t _mailStateVersion();
     void _onMailSave(WebServer *webServer, bool sendResponse = true);
     void _onMailTest(WebServer *webServer);
     bool _send(const char *subject, const char *body);
@@ -21,17 +21,30 @@ limitations under the License.
 
 #include "ewcMqtt.h"
 #include "ewcConfigServer.h"
+#include "../generated/ewcMqttAssets.h"
+#include "ewcBootTimeline.h"
+#include "ewcVersionTag.h"
+#include "ewcProfiler.h"
 #include <ArduinoJSON.h>
 #ifdef ESP8266
 #include <ESP8266WiFi.h>
 #else
 #include <WiFi.h>
 #endif
-#include "generated/mqttSetupHTML.h"
-#include "generated/mqttStateHTML.h"
 
 using namespace EWC;
 
+const Param<Mqtt> Mqtt::PARAM_LIST[] = {
+    paramBool<Mqtt>("enabled", &Mqtt::_paramEnabled, false, PARAM_FORM_CHECKBOX, "mqtt_enabled"),
+    paramString<Mqtt>("server", &Mqtt::_paramServer, "", 0, "mqtt_server"),
+    paramUInt16<Mqtt>("port", &Mqtt::_paramPort, 1883, 0, UINT16_MAX, PARAM_FORM_NON_EMPTY, "mqtt_port"),
+    paramString<Mqtt>("user", &Mqtt::_paramUser, "", 0, "mqtt_user"),
+    paramString<Mqtt>("pass", &Mqtt::_paramPassword, "", PARAM_SECRET, "mqtt_pass"),
+    paramString<Mqtt>("prefix", &Mqtt::_paramDiscoveryPrefix, nullptr, 0, "mqtt_prefix"),
+    paramUInt16<Mqtt>("send_interval", &Mqtt::_paramSendInterval, 0, 0, UINT16_MAX, PARAM_FORM_NON_EMPTY, "mqtt_send_interval"),
+};
+const ParamTable<Mqtt> Mqtt::PARAMS(Mqtt::PARAM_LIST);
+
 Mqtt::Mqtt(String prefix) : ConfigInterface("mqtt"), _defaultPrefix(prefix)
 {
 }
@@ -46,11 +59,12 @@ void Mqtt::setup(JsonDocument &config, bool resetConfig)
   _initParams();
   _fromJson(config);
   _initMqtt();
-  EWC::I::get().server().insertMenuG("MQTT", "/mqtt/setup", "menu_mqtt", FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_MQTT_SETUP_GZIP, sizeof(HTML_MQTT_SETUP_GZIP), true, 0);
-  EWC::I::get().server().webServer().on("/mqtt/config.json", std::bind(&Mqtt::_onMqttConfig, this, &EWC::I::get().server().webServer()));
+  EWC::I::get().server().addAssets(EWC_MQTT_ASSETS);
+  EWC::I::get().server().insertMenuA("MQTT", "/mqtt/setup", "menu_mqtt", true, 0);
+  EWC::I::get().server().addJsonProducer("mqtt_config", "/mqtt/config.json", std::bind(&Mqtt::_fillMqttConfig, this, std::placeholders::_1), true);
   EWC::I::get().server().webServer().on("/mqtt/config/save", std::bind(&Mqtt::_onMqttSave, this, &EWC::I::get().server().webServer()));
-  EWC::I::get().server().webServer().on("/mqtt/state.html", std::bind(&ConfigServer::sendContentG, &EWC::I::get().server(), &EWC::I::get().server().webServer(), FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_MQTT_STATE_GZIP, sizeof(HTML_MQTT_STATE_GZIP)));
-  EWC::I::get().server().webServer().on("/mqtt/state.json", std::bind(&Mqtt::_onMqttState, this, &EWC::I::get().server().webServer()));
+  EWC::I::get().server().enableAsset("/mqtt/state.html");
+  EWC::I::get().server().addJsonProducer("mqtt_state", "/mqtt/state.json", std::bind(&Mqtt::_fillMqttState, this, std::placeholders::_1), false, std::bind(&Mqtt::_mqttStateVersion, this));
   _mqttClient.onMessage(std::bind(&Mqtt::_messageReceived, this, std::placeholders::_1, std::placeholders::_2));
 #ifdef ESP8266
   _wifiConnectHandler = WiFi.onStationModeGotIP(std::bind(&Mqtt::_onWifiConnect, this, std::placeholders::_1));
@@ -63,6 +77,7 @@ void Mqtt::setup(JsonDocument &config, bool resetConfig)
 
 void Mqtt::loop()
 {
+  EWC_PROFILE_SCOPE("mqtt.loop");
   if (_paramEnabled)
   {
     _mqttClient.loop();
@@ -79,6 +94,10 @@ void Mqtt::loop()
         _connectToMqtt();
       }
     }
+    else if (!_bootPublished && I::get().boot().finished())
+    {
+      _publishBoot();
+    }
     if (_messages.size() > 0)
     {
       if (_cbOnMessage)
@@ -103,24 +122,19 @@ void Mqtt::loop()
 
 void Mqtt::fillJson(JsonDocument &config)
 {
-  config["mqtt"]["enabled"] = _paramEnabled;
-  config["mqtt"]["server"] = _paramServer;
-  config["mqtt"]["port"] = _paramPort;
-  config["mqtt"]["user"] = _paramUser;
-  config["mqtt"]["pass"] = _paramPassword;
-  config["mqtt"]["prefix"] = _paramDiscoveryPrefix;
-  config["mqtt"]["send_interval"] = _paramSendInterval;
+  PARAMS.toJson(*this, config["mqtt"].to<JsonObject>());
+}
+
+void Mqtt::removeSecrets(JsonDocument &config)
+{
+  PARAMS.removeSecrets(config["mqtt"]);
 }
 
 void Mqtt::_initParams()
 {
-  _paramEnabled = false;
-  _paramServer = "";
-  _paramPort = 1883;
-  _paramUser = "";
-  _paramPassword = "";
+  PARAMS.init(*this);
+  // the discovery prefix default is only known at runtime
   _paramDiscoveryPrefix = _defaultPrefix;
-  _paramSendInterval = 0;
 }
 
 void Mqtt::_initMqtt()
@@ -139,56 +153,13 @@ void Mqtt::_initMqtt()
 
 void Mqtt::_fromJson(JsonDocument &config)
 {
-  bool paramEnabled = false;
-  JsonVariant jv = config["mqtt"]["enabled"];
-  if (!jv.isNull())
-  {
-    paramEnabled = jv.as<bool>();
-  }
-  _paramEnabled = paramEnabled;
-  jv = config["mqtt"]["server"];
-  if (!jv.isNull())
-  {
-    _paramServer = jv.as<String>();
-  }
-  jv = config["mqtt"]["port"];
-  if (!jv.isNull())
-  {
-    _paramPort = jv.as<int>();
-  }
-  jv = config["mqtt"]["user"];
-  if (!jv.isNull())
-  {
-    _paramUser = jv.as<String>();
-  }
-  jv = config["mqtt"]["pass"];
-  if (!jv.isNull())
-  {
-    _paramPassword = jv.as<String>();
-  }
-  jv = config["mqtt"]["prefix"];
-  if (!jv.isNull())
-  {
-    _paramDiscoveryPrefix = jv.as<String>();
-  }
-  jv = config["mqtt"]["send_interval"];
-  if (!jv.isNull())
-  {
-    _paramSendInterval = jv.as<int>();
-  }
+  PARAMS.fromJson(*this, config["mqtt"]);
 }
 
-void Mqtt::_onMqttConfig(WebServer *request)
+void Mqtt::_fillMqttConfig(JsonDocument &jsonDoc)
 {
-  if (!I::get().server().isAuthenticated(request))
-  {
-    return request->requestAuthentication();
-  }
-  JsonDocument jsonDoc;
-  fillJson(jsonDoc);
-  String output;
-  serializeJson(jsonDoc, output);
-  request->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
+  // the password is not sent to the browser
+  PARAMS.toJson(*this, jsonDoc["mqtt"].to<JsonObject>(), false);
 }
 
 void Mqtt::_onMqttSave(WebServer *request)
@@ -197,56 +168,30 @@ void Mqtt::_onMqttSave(WebServer *request)
   {
     return request->requestAuthentication();
   }
-  for (int i = 0; i < request->args(); i++)
-  {
-    I::get().logger() << "  " << request->argName(i) << ": " << request->arg(i) << endl;
-  }
   JsonDocument config;
-  bool mqtt_enabled = false;
-  if (request->hasArg("mqtt_enabled"))
-  {
-    mqtt_enabled = request->arg("mqtt_enabled").equals("true");
-  }
-  config["mqtt"]["enabled"] = mqtt_enabled;
-  if (request->hasArg("mqtt_server"))
-  {
-    config["mqtt"]["server"] = request->arg("mqtt_server");
-  }
-  if (request->hasArg("mqtt_port") && !request->arg("mqtt_port").isEmpty())
-  {
-    config["mqtt"]["port"] = request->arg("mqtt_port").toInt();
-  }
-  if (request->hasArg("mqtt_user"))
-  {
-    config["mqtt"]["user"] = request->arg("mqtt_user");
-  }
-  if (request->hasArg("mqtt_pass"))
-  {
-    config["mqtt"]["pass"] = request->arg("mqtt_pass");
-  }
-  if (request->hasArg("mqtt_prefix"))
-  {
-    config["mqtt"]["prefix"] = request->arg("mqtt_prefix");
-  }
-  if (request->hasArg("mqtt_send_interval") && !request->arg("mqtt_send_interval").isEmpty())
-  {
-    config["mqtt"]["send_interval"] = request->arg("mqtt_send_interval").toInt();
-  }
+  PARAMS.fromForm(request, config["mqtt"].to<JsonObject>());
   _fromJson(config);
-  I::get().configFS().save();
-  String details;
-  serializeJsonPretty(config["mqtt"], details);
-  I::get().server().sendPageSuccess(request, "EWC MQTT save", "Save successful!", "/mqtt/setup", "<pre id=\"json\">" + details + "</pre>", "Back", "/mqtt/state.html", "MQTT State");
+  I::get().configFS().save(*this);
+  removeSecrets(config);
+  I::get().server().sendPageSuccessJson(request, "EWC MQTT save", "Save successful!", "/mqtt/setup", config["mqtt"], "Back", "/mqtt/state.html", "MQTT State");
   _initMqtt();
 }
 
-void Mqtt::_onMqttState(WebServer *request)
+/** Version of the values reported by _fillMqttState(). **/
+uint32_t Mqtt::_mqttStateVersion()
+{
+  return VersionTag()
+      .add(_paramEnabled)
+      .add(_paramEnabled && !_mqttClient.connected() && (_reconnectTs == 0 || millis() > _reconnectTs))
+      .add(_mqttClient.connected())
+      .add(_paramServer)
+      .add(_paramPort)
+      .add(_paramSendInterval)
+      .value();
+}
+
+void Mqtt::_fillMqttState(JsonDocument &jsonDoc)
 {
-  if (!I::get().server().isAuthenticated(request))
-  {
-    return request->requestAuthentication();
-  }
-  JsonDocument jsonDoc;
   jsonDoc["enabled"] = _paramEnabled;
   jsonDoc["connecting"] = _paramEnabled && !_mqttClient.connected() && (_reconnectTs == 0 || millis() > _reconnectTs);
   jsonDoc["connected"] = _mqttClient.connected();
@@ -255,9 +200,6 @@ void Mqtt::_onMqttState(WebServer *request)
   jsonDoc["server"] = _paramServer;
   jsonDoc["port"] = _paramPort;
   jsonDoc["send_interval"] = _paramSendInterval;
-  String output;
-  serializeJson(jsonDoc, output);
-  request->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
 }
 
 void Mqtt::_connectToMqtt()
@@ -319,6 +261,7 @@ bool Mqtt::subscribe(const String &topic, int qos)
 uint16_t Mqtt::publish(const String &topic, const String &payload, bool retained, int qos)
 {
   bool result = _mqttClient.publish(topic, payload, retained, qos);
+  I::get().metrics().mqttPublished(result);
   if (result)
   {
     uint16_t packetId = 0;
@@ -333,6 +276,20 @@ uint16_t Mqtt::publish(const String &topic, const String &payload, bool retained
   return 0;
 }
 
+void Mqtt::_publishBoot()
+{
+  _bootPublished = true;
+  BootTimeline &boot = I::get().boot();
+  // the payloads are small to fit into the buffer of the MQTT client
+  String topic = _paramDiscoveryPrefix + "/diagnostics/" + I::get().config().getChipId() + "/boot";
+  String payload = String("{\"version\":\"") + I::get().server().version() + "\",\"setup_us\":" + boot.setupUs() + ",\"connected_us\":" + boot.connectedUs() + "}";
+  publish(topic, payload, true);
+  for (uint8_t i = 0; i < boot.count(); i++)
+  {
+    publish(topic + "/" + boot.at(i).name, String(boot.duration(i)), true);
+  }
+}
+
 void Mqtt::_messageReceived(String &topic, String &payload)
 {
   // Note: Do not use the client in the callback to publish, subscribe or
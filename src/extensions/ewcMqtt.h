@@ -42,6 +42,7 @@ limitations under the License.
 #include <Arduino.h>
 #include <MQTT.h>
 #include "../ewcConfigInterface.h"
+#include "../ewcParam.h"
 
 namespace EWC
 {
@@ -71,6 +72,7 @@ namespace EWC
     /** === ConfigInterface Methods === **/
     void setup(JsonDocument &config, bool resetConfig = false);
     void fillJson(JsonDocument &config);
+    void removeSecrets(JsonDocument &config);
 
     void loop();
 
@@ -98,7 +100,9 @@ namespace EWC
     WiFiEventHandler _wifiDisconnectHandler;
 #endif
 
-    /** === Parameter === **/
+    /** === Parameter, described by PARAMS === **/
+    static const Param<Mqtt> PARAM_LIST[];
+    static const ParamTable<Mqtt> PARAMS;
     bool _paramEnabled;
     String _defaultPrefix;
     String _paramDiscoveryPrefix;
@@ -116,8 +120,9 @@ namespace EWC
     void _initParams();
     void _initMqtt();
     void _fromJson(JsonDocument &config);
-    void _onMqttConfig(WebServer *request);
-    void _onMqttState(WebServer *request);
+    void _fillMqttConfig(JsonDocument &jsonDoc);
+    void _fillMqttState(JsonDocument &jsonDoc);
+    uint32_t _mqttStateVersion();
     void _onMqttSave(WebServer *request);
 
 #if defined(ESP8266)
@@ -130,9 +135,12 @@ namespace EWC
 
     void _connectToMqtt();
     void _messageReceived(String &topic, String &payload);
+    /** Publishes the boot timeline as diagnostics, once per boot. **/
+    void _publishBoot();
 
   private:
     bool _connectionStateLast = false;
+    bool _bootPublished = false;
     std::vector<uint16_t> _lastSendAcks;
     std::vector<Message> _messages;
   };
@@ -21,6 +21,7 @@ limitations under the License.
 #include "../ewcInterface.h"
 #include "../ewcConfig.h"
 #include "../ewcConfigServer.h"
+#include "../ewcProfiler.h"
 #include "ewcMqttHA.h"
 
 using namespace EWC;
@@ -179,6 +180,7 @@ void MqttHA::setup(EWC::Mqtt &mqtt, String deviceId, String deviceName, String m
 
 void MqttHA::loop()
 {
+  EWC_PROFILE_SCOPE("mqtt_ha.loop");
   if (!_ewcMqtt->client().connected() || _ewcMqtt->getSendIntervalMs() == 0)
   {
     return;
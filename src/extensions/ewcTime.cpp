@@ -29,7 +29,6 @@ limitations under the License.
 #include <WiFiUdp.h>
 #endif
 #include "lwip/apps/sntp.h"
-#include "generated/timeSetupHTML.h"
 
 using namespace EWC;
 
@@ -49,8 +48,8 @@ void Time::setup(JsonDocument &config, bool resetConfig)
   I::get().logger() << F("[EWC Time] setup") << endl;
   _initParams();
   _fromJson(config);
-  EWC::I::get().server().insertMenuG("Time", "/time/setup", "menu_time", FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_TIME_SETUP_GZIP, sizeof(HTML_TIME_SETUP_GZIP), true, 0);
-  EWC::I::get().server().webServer().on("/time/config.json", std::bind(&Time::_onTimeConfig, this, &EWC::I::get().server().webServer()));
+  EWC::I::get().server().insertMenuA("Time", "/time/setup", "menu_time", true, 0);
+  EWC::I::get().server().addJsonProducer("time_config", "/time/config.json", std::bind(&Time::_fillTimeConfig, this, std::placeholders::_1));
   EWC::I::get().server().webServer().on("/time/config/save", std::bind(&Time::_onTimeSave, this, &EWC::I::get().server().webServer()));
 }
 
@@ -164,17 +163,9 @@ void Time::_fromJson(JsonDocument &config)
   _setupTime();
 }
 
-void Time::_onTimeConfig(WebServer *request)
+void Time::_fillTimeConfig(JsonDocument &jsonDoc)
 {
-  if (!I::get().server().isAuthenticated(request))
-  {
-    return request->requestAuthentication();
-  }
-  JsonDocument jsonDoc;
   fillJson(jsonDoc);
-  String output;
-  serializeJson(jsonDoc, output);
-  request->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
 }
 
 void Time::_onTimeSave(WebServer *request)
@@ -222,10 +213,8 @@ void Time::_onTimeSave(WebServer *request)
     }
   }
   _fromJson(config);
-  I::get().configFS().save();
-  String details;
-  serializeJsonPretty(config["time"], details);
-  I::get().server().sendPageSuccess(request, "EWC Time save", "Save successful!", "/time/setup", "<pre id=\"json\">" + details + "</pre>");
+  I::get().configFS().save(*this);
+  I::get().server().sendPageSuccessJson(request, "EWC Time save", "Save successful!", "/time/setup", config["time"]);
 }
 
 bool Time::timeAvailable()
@@ -86,7 +86,7 @@ namespace EWC
     void _initParams();
     void _fromJson(JsonDocument &config);
     void _callbackTimeSet(void);
-    void _onTimeConfig(WebServer *request);
+    void _fillTimeConfig(JsonDocument &jsonDoc);
     void _onTimeSave(WebServer *request);
 
     time_t _dndToMin(String &hmTime);
@@ -22,8 +22,9 @@ limitations under the License.
 // #include <ESPAsyncWebServer.h>
 #include "ewcUpdater.h"
 #include "ewcConfigServer.h"
+#include "../generated/ewcUpdateAssets.h"
 #include "ewcInterface.h"
-#include "generated/ewcUpdateHTML.h"
+#include "ewcProfiler.h"
 
 using namespace EWC;
 
@@ -42,16 +43,19 @@ void Updater::setup(JsonDocument &config, bool resetConfig)
   I::get().logger() << F("[EWC Updater] setup") << endl;
   _initParams();
   _fromJson(config);
-  I::get().server().insertMenuG("Update", "/ewc/update", "menu_update", FPSTR(PROGMEM_CONFIG_TEXT_HTML), HTML_EWC_UPDATE_GZIP, sizeof(HTML_EWC_UPDATE_GZIP), true, 0);
-  I::get().server().webServer().on("/ewc/update.json", std::bind(&Updater::_onUpdateInfo, this, &EWC::I::get().server().webServer()));
+  I::get().server().addAssets(EWC_UPDATE_ASSETS);
+  I::get().server().insertMenuA("Update", "/ewc/update", "menu_update", true, 0);
+  I::get().server().addJsonProducer("update", "/ewc/update.json", std::bind(&Updater::_fillUpdateInfo, this, std::placeholders::_1));
   I::get().server().webServer().on("/ewc/updatefw", HTTP_POST, std::bind(&Updater::_onUpdate, this, &EWC::I::get().server().webServer()),
                                    std::bind(&Updater::_onUpdateUpload, this, &EWC::I::get().server().webServer()));
 }
 
 void Updater::loop()
 {
+  EWC_PROFILE_SCOPE("updater.loop");
   if (_shouldReboot && millis() - _tsReboot > 3000)
   {
+    I::get().configFS().flush();
 #if defined(ESP8266)
     ESP.restart();
 #elif defined(ESP32)
@@ -104,6 +108,8 @@ void Updater::_onUpdateUpload(WebServer *server)
     WiFiUDP::stopAll();
 #endif
     I::get().logger() << F("[EWC Updater] Update Start: ") << upload.filename << endl;
+    // write a pending configuration before the flash is busy with the update
+    I::get().configFS().flush();
     uint32_t maxSketchSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
     if (!Update.begin(maxSketchSpace))
     { // start with max available size
@@ -131,16 +137,8 @@ void Updater::_onUpdateUpload(WebServer *server)
   yield();
 }
 
-void Updater::_onUpdateInfo(WebServer *server)
+void Updater::_fillUpdateInfo(JsonDocument &jsonDoc)
 {
-  if (!I::get().server().isAuthenticated(server))
-  {
-    return server->requestAuthentication();
-  }
-  JsonDocument jsonDoc;
   fillJson(jsonDoc);
   jsonDoc["update"]["version"] = I::get().server().version();
-  String output;
-  serializeJson(jsonDoc, output);
-  server->send(200, FPSTR(PROGMEM_CONFIG_APPLICATION_JSON), output);
 }
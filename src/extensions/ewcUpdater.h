@@ -65,7 +65,7 @@ namespace EWC
     long _tsReboot;
     void _onUpdate(WebServer *server);
     void _onUpdateUpload(WebServer *server);
-    void _onUpdateInfo(WebServer *server);
+    void _fillUpdateInfo(JsonDocument &jsonDoc);
     void _initParams();
     void _fromJson(JsonDocument &config);
   };
@@ -7,6 +7,8 @@ jsons.push(["/menu.json", "menu"]);
 let language = "en";
 let langmap = {};
 let cjson_url = undefined;
+// false if the server does not support /ewc/batch.json, e.g. on local test with a static web server
+let batch_supported = true;
 console.log("load json files: " + jsons);
 _loadJson();
 
@@ -19,6 +21,13 @@ function getJSON(uri, callback) {
 
 function _loadJson() {
   if (cjson_url === undefined) {
+    // request all pending dynamic JSON in one request, in the order of the single requests
+    let batch = jsons.filter((tuple) => !tuple[2]).reverse();
+    if (batch_supported && batch.length > 1) {
+      jsons = jsons.filter((tuple) => tuple[2]);
+      _loadBatch(batch);
+      return;
+    }
     let tuple = jsons.pop();
     if (tuple != undefined) {
       console.log("_loadJson, tuple: " + tuple);
@@ -26,8 +35,8 @@ function _loadJson() {
       cjson_url = url;
       let func = tuple[1];
       let request = new XMLHttpRequest();
+      // the server sends no-cache and an ETag, so the browser validates the stored response by If-None-Match
       request.open("GET", tuple[0]);
-      request.setRequestHeader("Cache-Control", "no-cache");
       request.overrideMimeType("application/json; charset=UTF-8");
       request.onreadystatechange = function () {
         try {
@@ -54,6 +63,54 @@ function _loadJson() {
   }
 }
 
+/** Loads all given tuples with one request. Not supported uris are loaded with single requests. **/
+function _loadBatch(batch) {
+  let url = "/ewc/batch.json?r=" + encodeURIComponent(batch.map((tuple) => tuple[0]).join(","));
+  console.log("_loadBatch: " + url);
+  cjson_url = url;
+  let request = new XMLHttpRequest();
+  request.open("GET", url);
+  request.setRequestHeader("Cache-Control", "no-cache");
+  request.overrideMimeType("application/json; charset=UTF-8");
+  request.onreadystatechange = function () {
+    if (request.readyState !== XMLHttpRequest.DONE) {
+      return;
+    }
+    let data = null;
+    try {
+      if (request.status === 200) {
+        console.log("--> got " + url);
+        data = JSON.parse(request.responseText);
+      } else {
+        batch_supported = false;
+      }
+    } catch (e) {
+      console.error(e);
+      batch_supported = false;
+    }
+    // the single requests are taken from the end
+    for (let i = batch.length - 1; i >= 0; i--) {
+      let tuple = batch[i];
+      if (data == null || data[tuple[0]] == null) {
+        jsons.push([tuple[0], tuple[1], true]);
+      }
+    }
+    for (let i = 0; data != null && i < batch.length; i++) {
+      let tuple = batch[i];
+      if (data[tuple[0]] != null) {
+        try {
+          window[tuple[1]](data[tuple[0]], tuple[0]);
+        } catch (e) {
+          console.error(e);
+        }
+      }
+    }
+    cjson_url = undefined;
+    _loadJson();
+  };
+  request.send();
+}
+
 function menu(data, uri) {
   console.log("load header");
   hh = '<header id="lb" class="lb-fixed">';
@@ -3,6 +3,7 @@ var timerSetup;
 var timerState;
 let countGetWifiStations = 0;
 let countGetWifiState = 0;
+let staticIPFilled = false;
 
 function wifistations(data, uri) {
   console.log("add stations", uri);
@@ -17,6 +18,8 @@ function wifistations(data, uri) {
   if (!data["finished"]) {
     countGetWifiStations += 1;
     setTimeout(getJSON.bind(null, "/wifi/stations.json", "wifistations"), 1000); //Ruft die Callback-Funktion nach 1 Sekunde auf
+  }
+  if (!data["finished"] && data["networks"].length == 0) {
     ih = '<label id="lbl_list_ssid_scan">scan in progress...</label>';
     ih +=
       '<label id="lbl_list_ssid_scan_count">' +
@@ -63,6 +66,33 @@ function wifistations(data, uri) {
   updateLanguageKeys(["lbl_total", "lbl_hidden"]);
 }
 
+function wifinetworks(data, uri) {
+  console.log("load known networks " + uri);
+  networks = data["networks"];
+  if (!networks || networks.length == 0) {
+    document.getElementById("list_known").innerHTML = "";
+    return;
+  }
+  hh = '<label id="lbl_known">Known networks:</label><br>';
+  for (i = 0; i < networks.length; i++) {
+    network = networks[i];
+    hh += '<label class="slist">' + network["ssid"];
+    if ("rssi" in network) {
+      hh += "&ensp;" + getRSSIasQuality(network["rssi"]) + "&#037;";
+    }
+    if (network["connected"]) {
+      hh += "&ensp;&#10004;";
+    }
+    hh += "</label>";
+    hh +=
+      '<input type="button" style="width:auto;padding:2px 10px;" onClick="onRemoveNetwork(this.getAttribute(\'data-ssid\'))" data-ssid="' +
+      network["ssid"] +
+      '" value="&#10005;"><br>';
+  }
+  document.getElementById("list_known").innerHTML = hh;
+  updateLanguageKeys(["lbl_known"]);
+}
+
 function getRSSIasQuality(rssi) {
   let quality = 0;
   if (rssi <= -100) {
@@ -121,4 +151,19 @@ function wifistate(data, uri) {
   }
   document.getElementById("ssid_current").innerHTML = hh;
   updateLanguageKeys(["btn_disconnect", "lbl_connected", "lbl_connecting"]);
+  fillStaticIP(data);
+}
+
+function fillStaticIP(data) {
+  // fill the form of the setup page once with the stored static configuration
+  dhcp = document.getElementById("dhcp");
+  if (staticIPFilled || dhcp == null || data["dhcp"] !== false) {
+    return;
+  }
+  staticIPFilled = true;
+  dhcp.checked = false;
+  ["stationIP", "gateway", "netmask", "dns1", "dns2"].forEach(function (n) {
+    document.getElementById(n).value = data[n];
+  });
+  vsw(true, "exp");
 }